@@ -0,0 +1,447 @@
+/* Copyright © 2025 Artem Shapovalov <artem_shapovalov@aol.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of  this  software and associated documentation files  (the “Software”),  to
+ * deal  in the Software without restriction, including without limitation  the
+ * rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell  copies of the Software, and to permit persons to whom the Software  is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The  above copyright notice and this permission notice shall be included  in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE  SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS  OR
+ * IMPLIED,  INCLUDING  BUT NOT LIMITED TO THE WARRANTIES  OF  MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL  THE
+ * AUTHORS  OR  COPYRIGHT  HOLDERS BE LIABLE FOR ANY CLAIM,  DAMAGES  OR  OTHER
+ * LIABILITY,  WHETHER  IN AN ACTION OF CONTRACT, TORT  OR  OTHERWISE,  ARISING
+ * FROM,  OUT  OF  OR  IN CONNECTION WITH THE SOFTWARE  OR  THE  USE  OR  OTHER
+ * DEALINGS IN THE SOFTWARE. */
+
+/* Throughput benchmark of the cipher stages and the block functions. The
+ * results are printed as JSON, one record per function and buffer size. Every
+ * case is warmed up and repeated, the median and the median absolute
+ * deviation of the repetitions are reported, see bench/compare.c. */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#else
+#define _POSIX_C_SOURCE 199309L
+#endif /* __linux__ */
+
+#include "encodex.c"
+#include "encodex_simd.h"
+#include "encodex_sbox.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif /* __linux__ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BENCH_TSC
+#endif /* __GNUC__ && (__x86_64__ || __i386__) */
+
+/* Every repetition processes at least this much data. */
+#define BENCH_MIN_BYTES (4u * 1024u * 1024u)
+
+/* Upper limit of the repetitions of a case. */
+#define BENCH_MAX_REPS 64u
+
+/* Buffer sizes from the L1 cache to DRAM. */
+static const size_t bench_sizes[] =
+{
+	16u * 1024u,
+	256u * 1024u,
+	4u * 1024u * 1024u,
+	64u * 1024u * 1024u
+};
+
+typedef void (*bench_block_fn)(uint8_t* block, const uint8_t* key);
+typedef void (*bench_bulk_fn)(uint8_t* blocks, size_t blocks_num,
+		const uint8_t* key);
+
+struct bench_case
+{
+	const char* name;
+	bench_block_fn block;
+	bench_bulk_fn bulk;
+};
+
+static void bench_cbc(uint8_t* blocks, size_t blocks_num, const uint8_t* key)
+{
+	encodex_cbc(blocks, blocks_num, key);
+}
+
+static void bench_decbc(uint8_t* blocks, size_t blocks_num,
+		const uint8_t* key)
+{
+	decodex_cbc(blocks, blocks_num, key);
+}
+
+/* Session keys of the batch cases, the blocks cycle through them. */
+#define BENCH_BATCH_KEYS 1024u
+
+static uint8_t bench_batch_keys[ENCODEX_KEY_SIZE_BYTES * BENCH_BATCH_KEYS];
+
+static void bench_batch(uint8_t* blocks, size_t blocks_num, const uint8_t* key,
+		int decode)
+{
+	size_t idx;
+	size_t num;
+
+	(void)key;
+
+	for (idx = 0; idx < blocks_num; idx += num)
+	{
+		num = ((blocks_num - idx) < BENCH_BATCH_KEYS)
+			? (blocks_num - idx) : BENCH_BATCH_KEYS;
+
+		if (decode != 0)
+		{
+			encodex_simd_batch_decode(encodex_simd_detect(),
+					&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES],
+					bench_batch_keys, num);
+		}
+		else
+		{
+			encodex_simd_batch_encode(encodex_simd_detect(),
+					&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES],
+					bench_batch_keys, num);
+		}
+	}
+}
+
+static void bench_batch_encode(uint8_t* blocks, size_t blocks_num,
+		const uint8_t* key)
+{
+	bench_batch(blocks, blocks_num, key, 0);
+}
+
+static void bench_batch_decode(uint8_t* blocks, size_t blocks_num,
+		const uint8_t* key)
+{
+	bench_batch(blocks, blocks_num, key, 1);
+}
+
+/* The tables are too big for the stack of the case. */
+static struct encodex_sbox bench_sbox;
+
+static void bench_sbox_encode(uint8_t* blocks, size_t blocks_num,
+		const uint8_t* key)
+{
+	encodex_sbox_init(&bench_sbox, key);
+	encodex_sbox_encode(&bench_sbox, blocks, blocks_num);
+}
+
+static void bench_sbox_decode(uint8_t* blocks, size_t blocks_num,
+		const uint8_t* key)
+{
+	encodex_sbox_init(&bench_sbox, key);
+	encodex_sbox_decode(&bench_sbox, blocks, blocks_num);
+}
+
+static const struct bench_case bench_cases[] =
+{
+	{ "rol_block", rol_block, NULL },
+	{ "revert_rol_block", revert_rol_block, NULL },
+	{ "add_key", add_key, NULL },
+	{ "revert_add_key", revert_add_key, NULL },
+	{ "noize", noize, NULL },
+	{ "revert_noize", revert_noize, NULL },
+	{ "shuffle", shuffle, NULL },
+	{ "revert_shuffle", revert_shuffle, NULL },
+	{ "encodex", encodex, NULL },
+	{ "decodex", decodex, NULL },
+	{ "encodex_ecb", NULL, encodex_ecb },
+	{ "decodex_ecb", NULL, decodex_ecb },
+	{ "encodex_simd_ecb", NULL, encodex_simd_ecb },
+	{ "decodex_simd_ecb", NULL, decodex_simd_ecb },
+	{ "encodex_sbox_ecb", NULL, bench_sbox_encode },
+	{ "decodex_sbox_ecb", NULL, bench_sbox_decode },
+	{ "encodex_simd_batch", NULL, bench_batch_encode },
+	{ "decodex_simd_batch", NULL, bench_batch_decode },
+	{ "encodex_cbc", NULL, bench_cbc },
+	{ "decodex_cbc", NULL, bench_decbc }
+};
+
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static uint64_t bench_cycles(void)
+{
+#ifdef BENCH_TSC
+	return __builtin_ia32_rdtsc();
+#else
+	return 0;
+#endif /* BENCH_TSC */
+}
+
+static void bench_sort(double* values, size_t num)
+{
+	size_t idx;
+	size_t pos;
+	double tmp;
+
+	for (idx = 1; idx < num; idx++)
+	{
+		tmp = values[idx];
+		for (pos = idx; (pos > 0u) && (values[pos - 1u] > tmp); pos--)
+		{
+			values[pos] = values[pos - 1u];
+		}
+
+		values[pos] = tmp;
+	}
+}
+
+/* Sorts the values and returns their median. */
+static double bench_median(double* values, size_t num)
+{
+	bench_sort(values, num);
+
+	return ((num % 2u) != 0u) ? values[num / 2u]
+		: ((values[(num / 2u) - 1u] + values[num / 2u]) * 0.5);
+}
+
+static double bench_mad(const double* values, size_t num, double median)
+{
+	double dev[BENCH_MAX_REPS];
+	size_t idx;
+
+	for (idx = 0; idx < num; idx++)
+	{
+		dev[idx] = (values[idx] > median) ? (values[idx] - median)
+			: (median - values[idx]);
+	}
+
+	return bench_median(dev, num);
+}
+
+static void bench_pass(const struct bench_case* bc, uint8_t* buf,
+		size_t blocks_num, const uint8_t* key)
+{
+	size_t idx;
+
+	if (bc->block != NULL)
+	{
+		for (idx = 0; idx < blocks_num; idx++)
+		{
+			bc->block(&buf[idx * ENCODEX_BLOCK_SIZE_BYTES], key);
+		}
+	}
+	else
+	{
+		bc->bulk(buf, blocks_num, key);
+	}
+}
+
+static void bench_run(const struct bench_case* bc, uint8_t* buf, size_t size,
+		const uint8_t* key, size_t reps, int first)
+{
+	double speed[BENCH_MAX_REPS];
+	double cpb[BENCH_MAX_REPS];
+	size_t blocks_num;
+	size_t passes;
+	size_t pass;
+	size_t rep;
+	uint64_t cycles;
+	double seconds;
+	double bytes;
+	double median;
+
+	blocks_num = size / ENCODEX_BLOCK_SIZE_BYTES;
+	passes = (BENCH_MIN_BYTES + size - 1u) / size;
+	bytes = (double)size * (double)passes;
+
+	/* Warm the caches, the branch predictors and the clock frequency up. */
+	bench_pass(bc, buf, blocks_num, key);
+
+	for (rep = 0; rep < reps; rep++)
+	{
+		seconds = bench_now();
+		cycles = bench_cycles();
+
+		for (pass = 0; pass < passes; pass++)
+		{
+			bench_pass(bc, buf, blocks_num, key);
+		}
+
+		cycles = bench_cycles() - cycles;
+		seconds = bench_now() - seconds;
+
+		speed[rep] = (bytes / seconds) * 1e-9;
+		cpb[rep] = (double)cycles / bytes;
+	}
+
+	median = bench_median(speed, reps);
+
+	printf("%s\n\t\t{ \"name\": \"%s\", \"bytes\": %lu, ",
+			(first != 0) ? "" : ",", bc->name, (unsigned long)size);
+#ifdef BENCH_TSC
+	printf("\"cycles_per_byte\": %.3f, ", bench_median(cpb, reps));
+#else
+	printf("\"cycles_per_byte\": null, ");
+#endif /* BENCH_TSC */
+	printf("\"gb_per_s\": %.4f, \"mad\": %.4f }", median,
+			bench_mad(speed, reps, median));
+	(void)fflush(stdout);
+}
+
+/* Pins the benchmark to one CPU, so the scheduler doesn't move it between
+ * the cores with different caches and clocks. */
+static int bench_pin(int cpu)
+{
+	int res;
+
+	res = 0;
+
+#ifdef __linux__
+	if (cpu >= 0)
+	{
+		cpu_set_t set;
+
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		res = sched_setaffinity(0, sizeof(set), &set);
+	}
+#else
+	(void)cpu;
+#endif /* __linux__ */
+
+	return res;
+}
+
+static void bench_help(void)
+{
+	(void)fprintf(stderr, "Usage: bench [options]\n");
+	(void)fprintf(stderr, "	--max-size N	- skip the buffers larger than N "
+			"bytes\n");
+	(void)fprintf(stderr, "	--reps N	- repetitions of every case, 1..%u, "
+			"5 by default\n", BENCH_MAX_REPS);
+	(void)fprintf(stderr, "	--cpu N	- pin the benchmark to the CPU N\n");
+}
+
+int main(int argc, char** argv)
+{
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+	uint8_t* buf;
+	size_t buf_size;
+	size_t max_size;
+	size_t reps;
+	size_t size_idx;
+	size_t case_idx;
+	size_t idx;
+	int cpu;
+	int first;
+	int res;
+
+	res = 0;
+	max_size = ~(size_t)0;
+	reps = 5;
+	cpu = -1;
+	buf = NULL;
+
+	for (idx = 1; (res == 0) && (idx < (size_t)argc); idx++)
+	{
+		if (((idx + 1u) < (size_t)argc)
+				&& (strcmp("--max-size", argv[idx]) == 0))
+		{
+			idx++;
+			max_size = (size_t)strtoul(argv[idx], NULL, 10);
+		}
+		else if (((idx + 1u) < (size_t)argc)
+				&& (strcmp("--reps", argv[idx]) == 0))
+		{
+			idx++;
+			reps = (size_t)strtoul(argv[idx], NULL, 10);
+			res = ((reps > 0u) && (reps <= BENCH_MAX_REPS)) ? 0 : -1;
+		}
+		else if (((idx + 1u) < (size_t)argc)
+				&& (strcmp("--cpu", argv[idx]) == 0))
+		{
+			idx++;
+			cpu = atoi(argv[idx]);
+		}
+		else
+		{
+			res = -1;
+		}
+	}
+
+	if (res != 0)
+	{
+		bench_help();
+	}
+	else if (bench_pin(cpu) != 0)
+	{
+		(void)fprintf(stderr, "Can't pin to the CPU %d\n", cpu);
+		res = -1;
+	}
+	else
+	{
+	}
+
+	buf_size = bench_sizes[(sizeof(bench_sizes) / sizeof(bench_sizes[0])) - 1u];
+
+	if (res == 0)
+	{
+		buf = (uint8_t*)malloc(buf_size);
+		res = (buf == NULL) ? -1 : 0;
+	}
+
+	for (idx = 0; (res == 0) && (idx < ENCODEX_KEY_SIZE_BYTES); idx++)
+	{
+		key[idx] = (uint8_t)((idx * 37u) + 11u);
+	}
+
+	for (idx = 0; idx < sizeof(bench_batch_keys); idx++)
+	{
+		bench_batch_keys[idx] = (uint8_t)((idx * 97u) + (idx >> 5u));
+	}
+
+	for (idx = 0; (res == 0) && (idx < buf_size); idx++)
+	{
+		buf[idx] = (uint8_t)(idx * 131u);
+	}
+
+	if (res == 0)
+	{
+		printf("{\n\t\"block_size\": %u,\n\t\"key_size\": %u,\n",
+				(unsigned int)ENCODEX_BLOCK_SIZE_BYTES,
+				(unsigned int)ENCODEX_KEY_SIZE_BYTES);
+		printf("\t\"simd\": \"%s\",\n\t\"reps\": %lu,\n",
+				encodex_simd_name(encodex_simd_detect()), (unsigned long)reps);
+		printf("\t\"results\": [");
+
+		first = 1;
+		for (size_idx = 0; size_idx < (sizeof(bench_sizes)
+					/ sizeof(bench_sizes[0])); size_idx++)
+		{
+			for (case_idx = 0; (bench_sizes[size_idx] <= max_size)
+					&& (case_idx < (sizeof(bench_cases)
+							/ sizeof(bench_cases[0]))); case_idx++)
+			{
+				bench_run(&bench_cases[case_idx], buf, bench_sizes[size_idx],
+						key, reps, first);
+				first = 0;
+			}
+		}
+
+		printf("\n\t]\n}\n");
+	}
+
+	free(buf);
+
+	return res;
+}
@@ -0,0 +1,260 @@
+/* Copyright © 2025 Artem Shapovalov <artem_shapovalov@aol.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of  this  software and associated documentation files  (the “Software”),  to
+ * deal  in the Software without restriction, including without limitation  the
+ * rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell  copies of the Software, and to permit persons to whom the Software  is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The  above copyright notice and this permission notice shall be included  in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE  SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS  OR
+ * IMPLIED,  INCLUDING  BUT NOT LIMITED TO THE WARRANTIES  OF  MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL  THE
+ * AUTHORS  OR  COPYRIGHT  HOLDERS BE LIABLE FOR ANY CLAIM,  DAMAGES  OR  OTHER
+ * LIABILITY,  WHETHER  IN AN ACTION OF CONTRACT, TORT  OR  OTHERWISE,  ARISING
+ * FROM,  OUT  OF  OR  IN CONNECTION WITH THE SOFTWARE  OR  THE  USE  OR  OTHER
+ * DEALINGS IN THE SOFTWARE. */
+
+/* Contended lookup benchmark of the schedule cache. A few hot keys are
+ * cached up front, then several threads acquire them in turns, start a
+ * context from the schedule and release it. The lookup rate is printed as
+ * JSON for every number of the threads up to --threads, with the speedup
+ * over a single thread, so the scaling of the hit path is visible. */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#else
+#define _POSIX_C_SOURCE 199309L
+#endif /* __linux__ */
+
+#include "encodex_cache.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Number of the hot keys, spread over all the shards. */
+#define BENCH_CACHE_KEYS 64u
+
+/* Upper limit of the threads. */
+#define BENCH_CACHE_MAX_THREADS 64u
+
+static uint8_t bench_cache_keys[BENCH_CACHE_KEYS][ENCODEX_KEY_SIZE_BYTES];
+
+/* The work of a single thread. */
+struct bench_cache_worker
+{
+	struct encodex_schedule_cache* cache;
+	size_t lookups;
+	size_t first;
+	size_t failed;
+};
+
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static void* bench_cache_run(void* arg)
+{
+	struct bench_cache_worker* worker;
+	const struct encodex_cached_schedule* sched;
+	struct encodex_ctx ctx;
+	size_t idx;
+
+	worker = (struct bench_cache_worker*)arg;
+
+	for (idx = 0; idx < worker->lookups; idx++)
+	{
+		sched = encodex_schedule_cache_acquire(worker->cache,
+				bench_cache_keys[(worker->first + idx) % BENCH_CACHE_KEYS]);
+
+		if (sched != NULL)
+		{
+			encodex_schedule_cache_ctx_init(&ctx, sched);
+			encodex_schedule_cache_release(worker->cache, sched);
+		}
+		else
+		{
+			worker->failed++;
+		}
+	}
+
+	return NULL;
+}
+
+/* Runs the lookups split between the threads, returns the lookups per
+ * second or a negative value on failure. */
+static double bench_cache_pass(struct encodex_schedule_cache* cache,
+		size_t threads_num, size_t lookups)
+{
+	pthread_t threads[BENCH_CACHE_MAX_THREADS];
+	struct bench_cache_worker workers[BENCH_CACHE_MAX_THREADS];
+	size_t started;
+	size_t idx;
+	double start;
+	double rate;
+
+	start = bench_now();
+
+	for (started = 0; started < threads_num; started++)
+	{
+		workers[started].cache = cache;
+		workers[started].lookups = lookups / threads_num;
+		workers[started].first = started * 7u;
+		workers[started].failed = 0;
+
+		if (pthread_create(&threads[started], NULL, bench_cache_run,
+					&workers[started]) != 0)
+		{
+			break;
+		}
+	}
+
+	rate = (started == threads_num) ? 0.0 : -1.0;
+
+	for (idx = 0; idx < started; idx++)
+	{
+		(void)pthread_join(threads[idx], NULL);
+		rate = (workers[idx].failed == 0u) ? rate : -1.0;
+	}
+
+	if (rate == 0.0)
+	{
+		rate = (double)((lookups / threads_num) * threads_num)
+			/ (bench_now() - start);
+	}
+
+	return rate;
+}
+
+static void bench_cache_help(void)
+{
+	(void)fprintf(stderr, "Usage: cache [options]\n");
+	(void)fprintf(stderr, "	--threads N	- the largest number of the threads, "
+			"1..%u, 8 by default\n", BENCH_CACHE_MAX_THREADS);
+	(void)fprintf(stderr, "	--lookups N	- lookups of every pass, "
+			"4000000 by default\n");
+}
+
+int main(int argc, char** argv)
+{
+	struct encodex_schedule_cache* cache;
+	const struct encodex_cached_schedule* sched;
+	size_t threads_max;
+	size_t threads_num;
+	size_t lookups;
+	size_t hits;
+	size_t misses;
+	size_t idx;
+	double single;
+	double rate;
+	int res;
+
+	res = 0;
+	threads_max = 8;
+	lookups = 4000000;
+	cache = NULL;
+	single = 0.0;
+
+	for (idx = 1; (res == 0) && (idx < (size_t)argc); idx++)
+	{
+		if (((idx + 1u) < (size_t)argc)
+				&& (strcmp("--threads", argv[idx]) == 0))
+		{
+			idx++;
+			threads_max = (size_t)strtoul(argv[idx], NULL, 10);
+			res = ((threads_max > 0u)
+					&& (threads_max <= BENCH_CACHE_MAX_THREADS)) ? 0 : -1;
+		}
+		else if (((idx + 1u) < (size_t)argc)
+				&& (strcmp("--lookups", argv[idx]) == 0))
+		{
+			idx++;
+			lookups = (size_t)strtoul(argv[idx], NULL, 10);
+			res = (lookups > 0u) ? 0 : -1;
+		}
+		else
+		{
+			res = -1;
+		}
+	}
+
+	if (res != 0)
+	{
+		bench_cache_help();
+	}
+	else
+	{
+		cache = encodex_schedule_cache_create(BENCH_CACHE_KEYS * 4u);
+		res = (cache == NULL) ? -1 : 0;
+	}
+
+	/* Every key is cached before the passes, so they measure the hits. */
+	for (idx = 0; (res == 0) && (idx < BENCH_CACHE_KEYS); idx++)
+	{
+		size_t pos;
+
+		for (pos = 0; pos < ENCODEX_KEY_SIZE_BYTES; pos++)
+		{
+			bench_cache_keys[idx][pos] = (uint8_t)((idx * 97u)
+					+ (pos * 31u) + 5u);
+		}
+
+		sched = encodex_schedule_cache_acquire(cache, bench_cache_keys[idx]);
+		res = (sched == NULL) ? -1 : 0;
+
+		if (sched != NULL)
+		{
+			encodex_schedule_cache_release(cache, sched);
+		}
+	}
+
+	if (res == 0)
+	{
+		printf("{\n\t\"keys\": %u,\n\t\"lookups\": %lu,\n",
+				BENCH_CACHE_KEYS, (unsigned long)lookups);
+		printf("\t\"results\": [");
+
+		for (threads_num = 1; (res == 0) && (threads_num <= threads_max);
+				threads_num *= 2u)
+		{
+			rate = bench_cache_pass(cache, threads_num, lookups);
+			res = (rate > 0.0) ? 0 : -1;
+			single = (threads_num == 1u) ? rate : single;
+
+			if (res == 0)
+			{
+				printf("%s\n\t\t{ \"threads\": %lu, \"lookups_per_s\": %.0f, "
+						"\"speedup\": %.2f }",
+						(threads_num == 1u) ? "" : ",",
+						(unsigned long)threads_num, rate, rate / single);
+			}
+		}
+
+		encodex_schedule_cache_stats(cache, &hits, &misses);
+		printf("\n\t],\n\t\"misses\": %lu\n}\n",
+				(unsigned long)(misses - BENCH_CACHE_KEYS));
+	}
+
+	if (res != 0)
+	{
+		(void)fprintf(stderr, "The cache benchmark failed\n");
+	}
+	else
+	{
+	}
+
+	encodex_schedule_cache_destroy(cache);
+
+	return res;
+}
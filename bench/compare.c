@@ -0,0 +1,176 @@
+/* Copyright © 2025 Artem Shapovalov <artem_shapovalov@aol.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of  this  software and associated documentation files  (the “Software”),  to
+ * deal  in the Software without restriction, including without limitation  the
+ * rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell  copies of the Software, and to permit persons to whom the Software  is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The  above copyright notice and this permission notice shall be included  in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE  SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS  OR
+ * IMPLIED,  INCLUDING  BUT NOT LIMITED TO THE WARRANTIES  OF  MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL  THE
+ * AUTHORS  OR  COPYRIGHT  HOLDERS BE LIABLE FOR ANY CLAIM,  DAMAGES  OR  OTHER
+ * LIABILITY,  WHETHER  IN AN ACTION OF CONTRACT, TORT  OR  OTHERWISE,  ARISING
+ * FROM,  OUT  OF  OR  IN CONNECTION WITH THE SOFTWARE  OR  THE  USE  OR  OTHER
+ * DEALINGS IN THE SOFTWARE. */
+
+/* Compares two result files of bench/bench.c. A case regresses when its
+ * median throughput drops more than the tolerance below the baseline and
+ * the drop is larger than the noise, three median absolute deviations of
+ * both runs. The cases are matched by the name and the buffer size, the
+ * cases missing in one of the files are reported and skipped. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COMPARE_MAX_CASES 256u
+#define COMPARE_NAME_SIZE 64u
+#define COMPARE_LINE_SIZE 512u
+
+struct compare_case
+{
+	char name[COMPARE_NAME_SIZE];
+	unsigned long bytes;
+	double speed;
+	double mad;
+};
+
+/* Reads the number following the field key in the line. */
+static int compare_field(const char* line, const char* key, double* value)
+{
+	const char* pos;
+	int res;
+
+	res = -1;
+	pos = strstr(line, key);
+	if ((pos != NULL) && (sscanf(&pos[strlen(key)], "%lf", value) == 1))
+	{
+		res = 0;
+	}
+
+	return res;
+}
+
+static size_t compare_load(const char* path, struct compare_case* cases)
+{
+	char line[COMPARE_LINE_SIZE];
+	const char* name;
+	const char* end;
+	double bytes;
+	size_t num;
+	FILE* f;
+
+	num = 0;
+	f = fopen(path, "r");
+	if (f == NULL)
+	{
+		(void)fprintf(stderr, "Can't open %s\n", path);
+	}
+
+	while ((f != NULL) && (num < COMPARE_MAX_CASES)
+			&& (fgets(line, (int)sizeof(line), f) != NULL))
+	{
+		name = strstr(line, "\"name\": \"");
+		end = (name != NULL) ? strchr(&name[9], '"') : NULL;
+
+		if ((end != NULL) && ((size_t)(end - &name[9]) < COMPARE_NAME_SIZE)
+				&& (compare_field(line, "\"bytes\": ", &bytes) == 0)
+				&& (compare_field(line, "\"gb_per_s\": ",
+						&cases[num].speed) == 0)
+				&& (compare_field(line, "\"mad\": ", &cases[num].mad) == 0))
+		{
+			(void)memcpy(cases[num].name, &name[9], (size_t)(end - &name[9]));
+			cases[num].name[end - &name[9]] = '\0';
+			cases[num].bytes = (unsigned long)bytes;
+			num++;
+		}
+	}
+
+	if (f != NULL)
+	{
+		(void)fclose(f);
+	}
+
+	return num;
+}
+
+int main(int argc, char** argv)
+{
+	static struct compare_case base[COMPARE_MAX_CASES];
+	static struct compare_case cur[COMPARE_MAX_CASES];
+	size_t base_num;
+	size_t cur_num;
+	size_t idx;
+	size_t pos;
+	size_t regressions;
+	double tolerance;
+	double delta;
+	double noise;
+	int res;
+
+	res = 0;
+	regressions = 0;
+	base_num = 0;
+	cur_num = 0;
+	tolerance = (argc > 3) ? atof(argv[3]) : 10.0;
+
+	if (argc < 3)
+	{
+		(void)fprintf(stderr, "Usage: compare <baseline.json> <current.json> "
+				"[tolerance %%, 10 by default]\n");
+		res = 2;
+	}
+
+	if (res == 0)
+	{
+		base_num = compare_load(argv[1], base);
+		cur_num = compare_load(argv[2], cur);
+		res = ((base_num > 0u) && (cur_num > 0u)) ? 0 : 2;
+	}
+
+	for (idx = 0; (res == 0) && (idx < base_num); idx++)
+	{
+		for (pos = 0; (pos < cur_num) && ((cur[pos].bytes != base[idx].bytes)
+					|| (strcmp(cur[pos].name, base[idx].name) != 0)); pos++)
+		{
+		}
+
+		if (pos == cur_num)
+		{
+			printf("%-20s %9lu	missing\n", base[idx].name, base[idx].bytes);
+		}
+		else
+		{
+			delta = ((cur[pos].speed - base[idx].speed) * 100.0)
+				/ base[idx].speed;
+			noise = 3.0 * (cur[pos].mad + base[idx].mad);
+
+			printf("%-20s %9lu	%8.4f -> %8.4f GB/s	%+6.1f%%",
+					base[idx].name, base[idx].bytes,
+					base[idx].speed, cur[pos].speed, delta);
+
+			if ((delta < -tolerance)
+					&& ((base[idx].speed - cur[pos].speed) > noise))
+			{
+				printf("	REGRESSION");
+				regressions++;
+			}
+
+			printf("\n");
+		}
+	}
+
+	if (res == 0)
+	{
+		printf("%lu regression(s), tolerance %.1f%%\n",
+				(unsigned long)regressions, tolerance);
+		res = (regressions > 0u) ? 1 : 0;
+	}
+
+	return res;
+}
@@ -20,140 +20,81 @@
 
 #include "encodex.h"
 
-/** \brief The seed value for the pseudo-random generator */
-static uint32_t random_seed = 0xc0ffee;
-
-/** \brief Initializes the pseudo-random generator with a new seed.
- *  \param seed The value for the new seed. */
-static void prnd_init(uint32_t seed)
+#ifdef ENCODEX_PROFILE
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PROFILE_TSC
+#else
+#include <time.h>
+#endif /* __GNUC__ && (__x86_64__ || __i386__) */
+
+/* Each thread counts on its own, so the counters need no locks. Without
+ * the thread-local storage they are shared and valid only while a single
+ * thread runs the algorithm. */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) \
+	&& !defined(__STDC_NO_THREADS__)
+#define PROFILE_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define PROFILE_LOCAL __thread
+#else
+#define PROFILE_LOCAL
+#endif /* thread-local storage */
+
+/** \brief The instrumentation counters, see encodex_profile_snapshot. */
+static PROFILE_LOCAL struct encodex_profile profile;
+
+/** \brief Reads the time source of the counters.
+ *  \return Current time in the cycles or the clock ticks. */
+static uint64_t profile_clock(void)
 {
-	random_seed = seed;
+#ifdef PROFILE_TSC
+	return __builtin_ia32_rdtsc();
+#else
+	return (uint64_t)clock();
+#endif /* PROFILE_TSC */
 }
 
-/** \brief Pseudo-random generator.
- *  \return Pseudo-random value. */
-static uint32_t prnd(void)
+/** \brief Accounts a single run of the stage.
+ *  \param stage The stage.
+ *  \param bytes Number of the bytes processed.
+ *  \param start Value of the profile_clock call made before the run. */
+static void profile_add(enum encodex_profile_stage stage, size_t bytes,
+		uint64_t start)
 {
-	random_seed ^= random_seed << 13;
-	random_seed ^= random_seed >> 17;
-	random_seed ^= random_seed <<  4;
-
-	return random_seed;
+	profile.stage[stage].calls++;
+	profile.stage[stage].bytes += bytes;
+	profile.stage[stage].cycles += profile_clock() - start;
 }
 
-/** \brief Sets the bit value to requested inside the 32-bit value.
- *  \param tgt Valid pointer to the value, where the bit should obtain a new
- *             value.
- *  \param val The value of the bit. If equals to 0, the requested bit would
- *             be set to 0, otherwise to 1.
- *  \param idx Number of the bit to set the value. Should not be greater than
- *             31. */
-static void set_bit(uint32_t* tgt, uint8_t val, size_t idx)
-{
-	if (val != 0u)
-	{
-		*tgt |= (1u << idx);
-	}
-	else
-	{
-		*tgt &= ~(1u << idx);
-	}
-}
+/** \brief Runs the call and accounts it to the stage. Expands to the bare
+ *         call when ENCODEX_PROFILE is not defined. */
+#define PROFILE_CALL(stage, bytes, call) \
+	do \
+	{ \
+		uint64_t profile_start; \
+		profile_start = profile_clock(); \
+		call; \
+		profile_add((stage), (bytes), profile_start); \
+	} while (0)
 
-/** \brief Returns the value of the requested bit.
- *  \param tgt The word to get the bit value.
- *  \param idx Number of the bit to get the value. Should not be greater than
- *             31.
- *  \return The value of the requested bit in the word. May be 1 or 0. */
-static uint8_t get_bit(uint32_t tgt, size_t idx)
-{
-	return ((tgt & ((uint32_t)1u << (idx & 0x1fu))) != 0u) ? 1u : 0u;
-}
+#else
 
-/** \brief Returns the XOR operation over two bits.
- *  \param b1 The value of the first bit. If equals 0 it would be recognized as
- *            0, otherwise as 1.
- *  \param b2 The value of the second bit. If equals 0 it would be recornized
- *            as 0, otherwise as 1.
- *  \return The result of the XOR operation. May be 1 or 0. */
-static uint8_t xor_bit(uint8_t b1, uint8_t b2)
-{
-	uint8_t _b1;
-	uint8_t _b2;
-
-	_b1 = (b1 != 0u) ? 1 : 0;
-	_b2 = (b2 != 0u) ? 1 : 0;
-	return (!(_b1 == _b2)) ? 1 : 0;
-}
-
-/** \brief Restores the value that was before XOR operation with left shift.
- *  \param val The word to restore.
- *  \param shift Value of the previous shift. Should not be greater than 31. */
-static uint32_t revert_lshift(uint32_t val, size_t shift)
-{
-	uint32_t res;
-	register size_t idx;
-
-	res = 0;
+#define PROFILE_CALL(stage, bytes, call) call
 
-	for (idx = 0; idx < shift; idx++)
-	{
-		set_bit(&res, get_bit(val, idx), idx);
-	}
+#endif /* ENCODEX_PROFILE */
 
-	for (idx = shift; idx < sizeof(uint32_t) * 8u; idx++)
-	{
-		set_bit(&res,
-			xor_bit(
-				get_bit(res, idx - shift),
-				get_bit(val, idx)),
-			idx);
-	}
-
-	return res;
-}
-
-/** \brief Restores the value that was before XOR operation with right shift.
- *  \param val The word to restore.
- *  \param shift Value of the previous shift. Should not be greater than 31. */
-static uint32_t revert_rshift(uint32_t val, size_t shift)
-{
-	uint32_t res;
-	register size_t idx;
-
-	res = 0;
-
-	for (idx = (sizeof(uint32_t) * 8u) - shift;
-			idx < sizeof(uint32_t) * 8u; idx++)
-	{
-		set_bit(&res, get_bit(val, idx), idx);
-	}
-
-	for (idx = 0; idx < (sizeof(uint32_t) * 8u) - shift; idx++)
-	{
-		set_bit(&res,
-			xor_bit(
-				get_bit(res, idx + shift),
-				get_bit(val, idx)),
-			idx);
-	}
-
-	return res;
-}
-
-/** \brief Restores the previous value in the pseudo-random sequence.
- *  \param current Current pseudo-random value.
- *  \return The previous pseudo-random value. */
-static uint32_t prnd_prev(uint32_t current)
+/** \brief Pseudo-random generator.
+ *  \param state Valid pointer to the generator state. Initially, it's a seed
+ *               value, this function overwrites the memory by this pointer
+ *               with the next state.
+ *  \return Pseudo-random value. */
+static uint32_t prnd(uint32_t* state)
 {
-	uint32_t _current;
-
-	_current = current;
-	_current = revert_lshift(_current,  4u);
-	_current = revert_rshift(_current, 17u);
-	_current = revert_lshift(_current, 13u);
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state <<  4;
 
-	return _current;
+	return *state;
 }
 
 /** \brief Cyclic rotation to left for each byte in a block with a values
@@ -172,7 +113,7 @@ static void rol_block(uint8_t* block, const uint8_t* key)
 	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
 	{
 		register uint8_t shift;
-		shift = key[idx] % 8u;
+		shift = key[idx % ENCODEX_KEY_SIZE_BYTES] % 8u;
 		block[idx] = 
 			(0xffu & (block[idx] << shift)) |
 			(0xffu & (block[idx] >> (8u - shift)));
@@ -195,7 +136,7 @@ static void add_key(uint8_t* block, const uint8_t* key)
 	{
 		register uint8_t d;
 		d = block[idx];
-		d += key[idx];
+		d += key[idx % ENCODEX_KEY_SIZE_BYTES];
 		block[idx] = d;
 	}
 }
@@ -239,12 +180,13 @@ static uint32_t convolute(const uint8_t* key)
 static void noize(uint8_t* block, const uint8_t* key)
 {
 	register size_t idx;
+	uint32_t state;
 
-	prnd_init(convolute(key));
+	state = convolute(key);
 
 	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
 	{
-		block[idx] ^= prnd() % 256u;
+		block[idx] ^= prnd(&state) % 256u;
 	}
 }
 
@@ -265,7 +207,8 @@ static void shuffle(uint8_t* block, const uint8_t* key)
 		register size_t idx2;
 		register uint8_t buf;
 
-		idx2 = key[idx1] % ENCODEX_KEY_SIZE_BYTES;
+		idx2 = key[idx1 % ENCODEX_KEY_SIZE_BYTES]
+			% ENCODEX_BLOCK_SIZE_BYTES;
 		buf = block[idx2];
 		block[idx2] = block[idx1];
 		block[idx1] = buf;
@@ -276,10 +219,14 @@ static void shuffle(uint8_t* block, const uint8_t* key)
 /* cppcheck-suppress misra-c2012-8.7 */
 void encodex(uint8_t* block, const uint8_t* key)
 {
-	rol_block(block, key);
-	add_key  (block, key);
-	noize    (block, key);
-	shuffle  (block, key);
+	PROFILE_CALL(ENCODEX_PROFILE_ROL, ENCODEX_BLOCK_SIZE_BYTES,
+			rol_block(block, key));
+	PROFILE_CALL(ENCODEX_PROFILE_ADD, ENCODEX_BLOCK_SIZE_BYTES,
+			add_key  (block, key));
+	PROFILE_CALL(ENCODEX_PROFILE_NOIZE, ENCODEX_BLOCK_SIZE_BYTES,
+			noize    (block, key));
+	PROFILE_CALL(ENCODEX_PROFILE_SHUFFLE, ENCODEX_BLOCK_SIZE_BYTES,
+			shuffle  (block, key));
 }
 
 /** \brief Reverts the rol_block function call.
@@ -298,7 +245,7 @@ static void revert_rol_block(uint8_t* block, const uint8_t* key)
 	{
 		register uint8_t shift;
 
-		shift = key[idx] % 8u;
+		shift = key[idx % ENCODEX_KEY_SIZE_BYTES] % 8u;
 		block[idx] = 
 			(block[idx] >> shift) |
 			(block[idx] << (8u - shift));
@@ -322,12 +269,13 @@ static void revert_add_key(uint8_t* block, const uint8_t* key)
 		register uint8_t d;
 
 		d = block[idx];
-		d -= key[idx];
+		d -= key[idx % ENCODEX_KEY_SIZE_BYTES];
 		block[idx] = d;
 	}
 }
 
-/** \brief Reverts the noize function call.
+/** \brief Reverts the noize function call. XOR is its own inverse, so the
+ *         same forward pseudo-random sequence is buffered and applied again.
  *  \param block Valid pointer to the block of memory. This memory would be
  *               modified and the new data would be written here instead of
  *               the old one. The size of the memory should be equal to the
@@ -338,18 +286,18 @@ static void revert_add_key(uint8_t* block, const uint8_t* key)
 static void revert_noize(uint8_t* block, const uint8_t* key)
 {
 	register size_t idx;
-	uint32_t seed;
+	uint32_t state;
+	uint8_t stream[ENCODEX_BLOCK_SIZE_BYTES];
 
-	prnd_init(convolute(key));
+	state = convolute(key);
 	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
 	{
-		seed = prnd();
+		stream[idx] = (uint8_t)(prnd(&state) % 256u);
 	}
 
 	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
 	{
-		block[ENCODEX_BLOCK_SIZE_BYTES - 1u - idx] ^= seed % 256u;
-		seed = prnd_prev(seed);
+		block[idx] ^= stream[idx];
 	}
 }
 
@@ -370,8 +318,8 @@ static void revert_shuffle(uint8_t* block, const uint8_t* key)
 		register size_t idx2;
 		register uint8_t buf;
 
-		idx2 = key[ENCODEX_BLOCK_SIZE_BYTES - 1u - idx1]
-			% ENCODEX_KEY_SIZE_BYTES;
+		idx2 = key[(ENCODEX_BLOCK_SIZE_BYTES - 1u - idx1)
+			% ENCODEX_KEY_SIZE_BYTES] % ENCODEX_BLOCK_SIZE_BYTES;
 		buf = block[idx2];
 		block[idx2] = block[ENCODEX_BLOCK_SIZE_BYTES - 1u - idx1];
 		block[ENCODEX_BLOCK_SIZE_BYTES - 1u - idx1] = buf;
@@ -382,10 +330,14 @@ static void revert_shuffle(uint8_t* block, const uint8_t* key)
 /* cppcheck-suppress misra-c2012-8.7 */
 void decodex(uint8_t* block, const uint8_t* key)
 {
-	revert_shuffle  (block, key);
-	revert_noize    (block, key);
-	revert_add_key  (block, key);
-	revert_rol_block(block, key);
+	PROFILE_CALL(ENCODEX_PROFILE_REVERT_SHUFFLE, ENCODEX_BLOCK_SIZE_BYTES,
+			revert_shuffle  (block, key));
+	PROFILE_CALL(ENCODEX_PROFILE_REVERT_NOIZE, ENCODEX_BLOCK_SIZE_BYTES,
+			revert_noize    (block, key));
+	PROFILE_CALL(ENCODEX_PROFILE_REVERT_ADD, ENCODEX_BLOCK_SIZE_BYTES,
+			revert_add_key  (block, key));
+	PROFILE_CALL(ENCODEX_PROFILE_REVERT_ROL, ENCODEX_BLOCK_SIZE_BYTES,
+			revert_rol_block(block, key));
 }
 
 /** \brief Cypher block-chaining algorithm. Updates the value of the given key
@@ -400,14 +352,87 @@ void decodex(uint8_t* block, const uint8_t* key)
 static uint32_t cbc(uint8_t* key, uint32_t seed)
 {
 	register size_t idx;
-	
-	prnd_init(seed);
+	uint32_t state;
+
+#ifdef ENCODEX_PROFILE
+	uint64_t profile_start;
+
+	profile_start = profile_clock();
+#endif /* ENCODEX_PROFILE */
+
+	state = seed;
 	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
 	{
-		key[idx] ^= prnd() % 256u;
+		key[idx] ^= prnd(&state) % 256u;
 	}
 
-	return prnd_prev(prnd());
+#ifdef ENCODEX_PROFILE
+	profile_add(ENCODEX_PROFILE_CBC, ENCODEX_KEY_SIZE_BYTES, profile_start);
+#endif /* ENCODEX_PROFILE */
+
+	return state;
+}
+
+/** \brief Number of bits in the pseudo-random generator state. */
+#define PRND_BITS (sizeof(uint32_t) * 8u)
+
+/** \brief Multiplies the GF(2) matrix by the vector. The pseudo-random
+ *         generator is linear over GF(2), so any number of its steps may be
+ *         expressed as such a matrix.
+ *  \param mat Valid pointer to the matrix, stored as PRND_BITS columns, the
+ *             column idx is the image of the bit idx.
+ *  \param vec The vector.
+ *  \return The product. */
+static uint32_t gf2_apply(const uint32_t* mat, uint32_t vec)
+{
+	register size_t idx;
+	uint32_t res;
+
+	res = 0;
+
+	for (idx = 0; idx < PRND_BITS; idx++)
+	{
+		if (((vec >> idx) & 1u) != 0u)
+		{
+			res ^= mat[idx];
+		}
+	}
+
+	return res;
+}
+
+/** \brief Multiplies two GF(2) matrices.
+ *  \param res Valid pointer to the result matrix of PRND_BITS columns. May be
+ *             the same memory as any of the operands.
+ *  \param a Valid pointer to the left operand matrix.
+ *  \param b Valid pointer to the right operand matrix. */
+static void gf2_mul(uint32_t* res, const uint32_t* a, const uint32_t* b)
+{
+	register size_t idx;
+	uint32_t tmp[PRND_BITS];
+
+	for (idx = 0; idx < PRND_BITS; idx++)
+	{
+		tmp[idx] = gf2_apply(a, b[idx]);
+	}
+
+	for (idx = 0; idx < PRND_BITS; idx++)
+	{
+		res[idx] = tmp[idx];
+	}
+}
+
+/** \brief Adds the second GF(2) matrix to the first one.
+ *  \param res Valid pointer to the matrix to update.
+ *  \param a Valid pointer to the matrix to add. */
+static void gf2_add(uint32_t* res, const uint32_t* a)
+{
+	register size_t idx;
+
+	for (idx = 0; idx < PRND_BITS; idx++)
+	{
+		res[idx] ^= a[idx];
+	}
 }
 
 void encodex_cbc_stream_init(const uint8_t* key, uint32_t* seed)
@@ -431,46 +456,737 @@ void decodex_cbc_stream(uint8_t* block, uint8_t* key, uint32_t* seed)
 	decodex(block, key);
 }
 
+/** \brief Applies the key schedule to the block, the result is the same as
+ *         the encodex function call gives.
+ *  \param sched Valid pointer to the initialized key schedule.
+ *  \param dst Valid pointer to the memory for the encrypted block. The size
+ *             of the memory should be equal to ENCODEX_BLOCK_SIZE_BYTES. Should
+ *             not overlap with the src memory.
+ *  \param src Valid pointer to the block to encrypt. The size of the memory
+ *             should be equal to ENCODEX_BLOCK_SIZE_BYTES. */
+static void schedule_encode_to(const struct encodex_schedule* sched,
+		uint8_t* dst, const uint8_t* src)
+{
+	register size_t idx;
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
+		register size_t from;
+		register uint8_t shift;
+		register uint8_t d;
+
+		from = sched->perm[idx];
+		shift = sched->rol[from];
+		d = src[from];
+		d = (0xffu & (d << shift)) | (0xffu & (d >> (8u - shift)));
+		d += sched->key[from];
+		d ^= sched->noize[from];
+		dst[idx] = d;
+	}
+}
+
+/** \brief Applies the inverse key schedule to the block, the result is the
+ *         same as the decodex function call gives.
+ *  \param sched Valid pointer to the initialized key schedule.
+ *  \param dst Valid pointer to the memory for the decrypted block. The size
+ *             of the memory should be equal to ENCODEX_BLOCK_SIZE_BYTES. Should
+ *             not overlap with the src memory.
+ *  \param src Valid pointer to the block to decrypt. The size of the memory
+ *             should be equal to ENCODEX_BLOCK_SIZE_BYTES. */
+static void schedule_decode_to(const struct encodex_schedule* sched,
+		uint8_t* dst, const uint8_t* src)
+{
+	register size_t idx;
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
+		register uint8_t shift;
+		register uint8_t d;
+
+		shift = sched->rol[idx];
+		d = src[sched->inv_perm[idx]];
+		d ^= sched->noize[idx];
+		d -= sched->key[idx];
+		d = (0xffu & (d >> shift)) | (0xffu & (d << (8u - shift)));
+		dst[idx] = d;
+	}
+}
+
 /* cppcheck-suppress unusedFunction */
 /* cppcheck-suppress misra-c2012-8.7 */
-void encodex_cbc(uint8_t* blocks, size_t blocks_num, const uint8_t* key)
+void encodex_schedule_perm(uint8_t* perm, uint8_t* inv_perm,
+		const uint8_t* key)
+{
+	register size_t idx;
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
+		perm[idx] = (uint8_t)idx;
+	}
+
+	shuffle(perm, key);
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
+		inv_perm[perm[idx]] = (uint8_t)idx;
+	}
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_schedule_init(struct encodex_schedule* sched, const uint8_t* key)
+{
+	register size_t idx;
+	uint32_t state;
+#ifdef ENCODEX_PROFILE
+	uint64_t profile_start;
+
+	profile_start = profile_clock();
+#endif /* ENCODEX_PROFILE */
+
+	state = convolute(key);
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
+		sched->key[idx] = key[idx % ENCODEX_KEY_SIZE_BYTES];
+		sched->rol[idx] = sched->key[idx] % 8u;
+		sched->noize[idx] = (uint8_t)(prnd(&state) % 256u);
+	}
+
+	encodex_schedule_perm(sched->perm, sched->inv_perm, key);
+
+#ifdef ENCODEX_PROFILE
+	profile_add(ENCODEX_PROFILE_SCHEDULE, ENCODEX_KEY_SIZE_BYTES,
+			profile_start);
+#endif /* ENCODEX_PROFILE */
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_schedule_encode(const struct encodex_schedule* sched,
+		uint8_t* block)
+{
+	register size_t idx;
+	uint8_t buf[ENCODEX_BLOCK_SIZE_BYTES];
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
+		buf[idx] = block[idx];
+	}
+
+	schedule_encode_to(sched, block, buf);
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_schedule_decode(const struct encodex_schedule* sched,
+		uint8_t* block)
+{
+	register size_t idx;
+	uint8_t buf[ENCODEX_BLOCK_SIZE_BYTES];
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
+		buf[idx] = block[idx];
+	}
+
+	schedule_decode_to(sched, block, buf);
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_ecb(uint8_t* blocks, size_t blocks_num, const uint8_t* key)
+{
+	register size_t idx;
+	struct encodex_schedule sched;
+
+	encodex_schedule_init(&sched, key);
+
+	for (idx = 0; idx < blocks_num; idx++)
+	{
+		encodex_schedule_encode(&sched,
+				&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES]);
+	}
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void decodex_ecb(uint8_t* blocks, size_t blocks_num, const uint8_t* key)
+{
+	register size_t idx;
+	struct encodex_schedule sched;
+
+	encodex_schedule_init(&sched, key);
+
+	for (idx = 0; idx < blocks_num; idx++)
+	{
+		encodex_schedule_decode(&sched,
+				&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES]);
+	}
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_ctx_init(struct encodex_ctx* ctx, const uint8_t* key)
 {
 	register size_t idx;
-	uint32_t seed;
-	uint8_t _key[ENCODEX_KEY_SIZE_BYTES];
 
 	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
 	{
-		_key[idx] = key[idx];
+		ctx->chain[idx] = key[idx];
+	}
+
+	encodex_schedule_init(&ctx->schedule, key);
+	encodex_cbc_stream_init(key, &ctx->seed);
+	ctx->buf_len = 0;
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_ctx_encode(const struct encodex_ctx* ctx, uint8_t* block)
+{
+	encodex_schedule_encode(&ctx->schedule, block);
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_ctx_decode(const struct encodex_ctx* ctx, uint8_t* block)
+{
+	encodex_schedule_decode(&ctx->schedule, block);
+}
+
+/** \brief Steps the cypher block chain of the context and encodes a single
+ *         block with the new key.
+ *  \param ctx Valid pointer to the initialized context.
+ *  \param dst Valid pointer to the memory for the encrypted block. The size
+ *             of the memory should be equal to ENCODEX_BLOCK_SIZE_BYTES. May be
+ *             equal to the src, otherwise should not overlap with it.
+ *  \param src Valid pointer to the block to encrypt. The size of the memory
+ *             should be equal to ENCODEX_BLOCK_SIZE_BYTES. */
+static void ctx_encode_cbc_to(struct encodex_ctx* ctx, uint8_t* dst,
+		const uint8_t* src)
+{
+	struct encodex_schedule sched;
+
+	ctx->seed = cbc(ctx->chain, ctx->seed);
+	encodex_schedule_init(&sched, ctx->chain);
+
+	if (dst == src)
+	{
+		encodex_schedule_encode(&sched, dst);
+	}
+	else
+	{
+		schedule_encode_to(&sched, dst, src);
 	}
+}
+
+/** \brief Steps the cypher block chain of the context and decodes a single
+ *         block with the new key.
+ *  \param ctx Valid pointer to the initialized context.
+ *  \param dst Valid pointer to the memory for the decrypted block. The size
+ *             of the memory should be equal to ENCODEX_BLOCK_SIZE_BYTES. May be
+ *             equal to the src, otherwise should not overlap with it.
+ *  \param src Valid pointer to the block to decrypt. The size of the memory
+ *             should be equal to ENCODEX_BLOCK_SIZE_BYTES. */
+static void ctx_decode_cbc_to(struct encodex_ctx* ctx, uint8_t* dst,
+		const uint8_t* src)
+{
+	struct encodex_schedule sched;
 
-	encodex_cbc_stream_init(_key, &seed);
+	ctx->seed = cbc(ctx->chain, ctx->seed);
+	encodex_schedule_init(&sched, ctx->chain);
+
+	if (dst == src)
+	{
+		encodex_schedule_decode(&sched, dst);
+	}
+	else
+	{
+		schedule_decode_to(&sched, dst, src);
+	}
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_ctx_encode_cbc(struct encodex_ctx* ctx, uint8_t* blocks,
+		size_t blocks_num)
+{
+	register size_t idx;
 
 	for (idx = 0; idx < blocks_num; idx++)
 	{
-		encodex_cbc_stream(&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES],
-				_key, &seed);
+		ctx_encode_cbc_to(ctx, &blocks[idx * ENCODEX_BLOCK_SIZE_BYTES],
+				&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES]);
 	}
 }
 
 /* cppcheck-suppress unusedFunction */
 /* cppcheck-suppress misra-c2012-8.7 */
-void decodex_cbc(uint8_t* blocks, size_t blocks_num, const uint8_t* key)
+void encodex_ctx_decode_cbc(struct encodex_ctx* ctx, uint8_t* blocks,
+		size_t blocks_num)
 {
 	register size_t idx;
+
+	for (idx = 0; idx < blocks_num; idx++)
+	{
+		ctx_decode_cbc_to(ctx, &blocks[idx * ENCODEX_BLOCK_SIZE_BYTES],
+				&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES]);
+	}
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_cbc_seek(struct encodex_ctx* ctx, size_t block_index)
+{
+	register size_t idx;
+	size_t bit;
 	uint32_t seed;
-	uint8_t _key[ENCODEX_KEY_SIZE_BYTES];
+	uint32_t sum;
+	uint32_t step[PRND_BITS];
+	uint32_t power[PRND_BITS];
+	uint32_t series[PRND_BITS];
+	uint32_t tmp[PRND_BITS];
+
+	/* Each chain step runs the generator ENCODEX_KEY_SIZE_BYTES times, so
+	 * the seed of the block n is step^n * seed and the key of the block n
+	 * is the initial key XOR-ed with the keystream of the sum of all the
+	 * previous seeds, (step^0 + ... + step^(n-1)) * seed. Both are built by
+	 * the binary exponentiation: power = step^n, series = the sum. */
+	for (idx = 0; idx < PRND_BITS; idx++)
+	{
+		uint32_t state;
+
+		state = (uint32_t)1u << idx;
+		for (bit = 0; bit < ENCODEX_KEY_SIZE_BYTES; bit++)
+		{
+			(void)prnd(&state);
+		}
+
+		step[idx] = state;
+		power[idx] = (uint32_t)1u << idx;
+		series[idx] = 0;
+	}
+
+	for (bit = sizeof(size_t) * 8u; bit > 0u; bit--)
+	{
+		gf2_mul(tmp, power, series);
+		gf2_add(series, tmp);
+		gf2_mul(power, power, power);
+
+		if (((block_index >> (bit - 1u)) & 1u) != 0u)
+		{
+			gf2_add(series, power);
+			gf2_mul(power, power, step);
+		}
+	}
+
+	seed = convolute(ctx->schedule.key);
+	sum = gf2_apply(series, seed);
 
 	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
 	{
-		_key[idx] = key[idx];
+		ctx->chain[idx] = ctx->schedule.key[idx]
+			^ (uint8_t)(prnd(&sum) % 256u);
+	}
+
+	ctx->seed = gf2_apply(power, seed);
+	ctx->buf_len = 0;
+}
+
+/** \brief Runs the cypher block chain over the segments in place. The
+ *         blocks inside a segment are processed where they are, the blocks
+ *         crossing the segment edges are gathered into a local block and
+ *         scattered back.
+ *  \param ctx Valid pointer to the initialized context.
+ *  \param iov Valid pointer to the segments.
+ *  \param iov_num Number of the segments.
+ *  \param encode Non-zero to encode, zero to decode.
+ *  \return 0 on success, -1 if the total size is not a multiple of the
+ *          block size, nothing is processed then. */
+static int ctx_cbc_iov(struct encodex_ctx* ctx,
+		const struct encodex_iovec* iov, size_t iov_num, int encode)
+{
+	register size_t idx;
+	size_t seg;
+	size_t pos;
+	size_t fill;
+	int res;
+	uint8_t* base;
+	uint8_t* where[ENCODEX_BLOCK_SIZE_BYTES];
+	uint8_t block[ENCODEX_BLOCK_SIZE_BYTES];
+
+	fill = 0;
+
+	for (seg = 0; seg < iov_num; seg++)
+	{
+		fill = (fill + (iov[seg].iov_len % ENCODEX_BLOCK_SIZE_BYTES))
+			% ENCODEX_BLOCK_SIZE_BYTES;
+	}
+
+	res = (fill == 0u) ? 0 : -1;
+
+	for (seg = 0; (res == 0) && (seg < iov_num); seg++)
+	{
+		base = (uint8_t*)iov[seg].iov_base;
+		pos = 0;
+
+		while (pos < iov[seg].iov_len)
+		{
+			if ((fill == 0u)
+					&& ((iov[seg].iov_len - pos) >= ENCODEX_BLOCK_SIZE_BYTES))
+			{
+				if (encode != 0)
+				{
+					ctx_encode_cbc_to(ctx, &base[pos], &base[pos]);
+				}
+				else
+				{
+					ctx_decode_cbc_to(ctx, &base[pos], &base[pos]);
+				}
+
+				pos += ENCODEX_BLOCK_SIZE_BYTES;
+			}
+			else
+			{
+				where[fill] = &base[pos];
+				block[fill] = base[pos];
+				fill++;
+				pos++;
+			}
+
+			if (fill == ENCODEX_BLOCK_SIZE_BYTES)
+			{
+				if (encode != 0)
+				{
+					ctx_encode_cbc_to(ctx, block, block);
+				}
+				else
+				{
+					ctx_decode_cbc_to(ctx, block, block);
+				}
+
+				for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+				{
+					*where[idx] = block[idx];
+				}
+
+				fill = 0;
+			}
+		}
+	}
+
+	return res;
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+int encodex_cbc_iov(struct encodex_ctx* ctx,
+		const struct encodex_iovec* iov, size_t iov_num)
+{
+	return ctx_cbc_iov(ctx, iov, iov_num, 1);
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+int decodex_cbc_iov(struct encodex_ctx* ctx,
+		const struct encodex_iovec* iov, size_t iov_num)
+{
+	return ctx_cbc_iov(ctx, iov, iov_num, 0);
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+size_t encodex_cbc_update(struct encodex_ctx* ctx, const uint8_t* in,
+		size_t len, uint8_t* out)
+{
+	register size_t idx;
+	size_t pos;
+	size_t res;
+
+	pos = 0;
+	res = 0;
+
+	while (pos < len)
+	{
+		if ((ctx->buf_len == 0u) && ((len - pos) >= ENCODEX_BLOCK_SIZE_BYTES))
+		{
+			ctx_encode_cbc_to(ctx, &out[res], &in[pos]);
+			pos += ENCODEX_BLOCK_SIZE_BYTES;
+			res += ENCODEX_BLOCK_SIZE_BYTES;
+		}
+		else
+		{
+			for (idx = ctx->buf_len; (idx < ENCODEX_BLOCK_SIZE_BYTES)
+					&& (pos < len); idx++)
+			{
+				ctx->buf[idx] = in[pos];
+				pos++;
+			}
+
+			ctx->buf_len = idx;
+			if (ctx->buf_len == ENCODEX_BLOCK_SIZE_BYTES)
+			{
+				ctx_encode_cbc_to(ctx, &out[res], ctx->buf);
+				res += ENCODEX_BLOCK_SIZE_BYTES;
+				ctx->buf_len = 0;
+			}
+		}
+	}
+
+	return res;
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+size_t encodex_cbc_final(struct encodex_ctx* ctx, uint8_t* out)
+{
+	register size_t idx;
+	uint8_t pad;
+
+	pad = (uint8_t)((ENCODEX_BLOCK_SIZE_BYTES - ctx->buf_len) % 256u);
+	for (idx = ctx->buf_len; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
+		ctx->buf[idx] = pad;
+	}
+
+	ctx_encode_cbc_to(ctx, out, ctx->buf);
+	ctx->buf_len = 0;
+
+	return ENCODEX_BLOCK_SIZE_BYTES;
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+size_t decodex_cbc_update(struct encodex_ctx* ctx, const uint8_t* in,
+		size_t len, uint8_t* out)
+{
+	register size_t idx;
+	size_t pos;
+	size_t res;
+
+	pos = 0;
+	res = 0;
+
+	/* The last complete block stays in the buffer, it may be the padding. */
+	while (pos < len)
+	{
+		if (ctx->buf_len == ENCODEX_BLOCK_SIZE_BYTES)
+		{
+			ctx_decode_cbc_to(ctx, &out[res], ctx->buf);
+			res += ENCODEX_BLOCK_SIZE_BYTES;
+			ctx->buf_len = 0;
+		}
+		else if ((ctx->buf_len == 0u)
+				&& ((len - pos) > ENCODEX_BLOCK_SIZE_BYTES))
+		{
+			ctx_decode_cbc_to(ctx, &out[res], &in[pos]);
+			pos += ENCODEX_BLOCK_SIZE_BYTES;
+			res += ENCODEX_BLOCK_SIZE_BYTES;
+		}
+		else
+		{
+			for (idx = ctx->buf_len; (idx < ENCODEX_BLOCK_SIZE_BYTES)
+					&& (pos < len); idx++)
+			{
+				ctx->buf[idx] = in[pos];
+				pos++;
+			}
+
+			ctx->buf_len = idx;
+		}
 	}
 
-	encodex_cbc_stream_init(_key, &seed);
+	return res;
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+int decodex_cbc_final(struct encodex_ctx* ctx, uint8_t* out, size_t* out_len)
+{
+	register size_t idx;
+	size_t pad;
+	int res;
+
+	res = -1;
+
+	if (ctx->buf_len == ENCODEX_BLOCK_SIZE_BYTES)
+	{
+		ctx_decode_cbc_to(ctx, ctx->buf, ctx->buf);
+		pad = ctx->buf[ENCODEX_BLOCK_SIZE_BYTES - 1u];
+		pad = (pad == 0u) ? 256u : pad;
+		res = (pad <= ENCODEX_BLOCK_SIZE_BYTES) ? 0 : -1;
+
+		for (idx = ENCODEX_BLOCK_SIZE_BYTES - pad; (res == 0)
+				&& (idx < ENCODEX_BLOCK_SIZE_BYTES); idx++)
+		{
+			res = (ctx->buf[idx] == (uint8_t)(pad % 256u)) ? 0 : -1;
+		}
+
+		for (idx = 0; (res == 0)
+				&& (idx < (ENCODEX_BLOCK_SIZE_BYTES - pad)); idx++)
+		{
+			out[idx] = ctx->buf[idx];
+		}
+
+		if (res == 0)
+		{
+			*out_len = ENCODEX_BLOCK_SIZE_BYTES - pad;
+		}
+	}
+
+	ctx->buf_len = 0;
+
+	return res;
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_cbc(uint8_t* blocks, size_t blocks_num, const uint8_t* key)
+{
+	struct encodex_ctx ctx;
+
+	encodex_ctx_init(&ctx, key);
+	encodex_ctx_encode_cbc(&ctx, blocks, blocks_num);
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void decodex_cbc(uint8_t* blocks, size_t blocks_num, const uint8_t* key)
+{
+	struct encodex_ctx ctx;
+
+	encodex_ctx_init(&ctx, key);
+	encodex_ctx_decode_cbc(&ctx, blocks, blocks_num);
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_ecb_to(uint8_t* dst, const uint8_t* src, size_t blocks_num,
+		const uint8_t* key)
+{
+	register size_t idx;
+	struct encodex_schedule sched;
+
+	if (dst == src)
+	{
+		encodex_ecb(dst, blocks_num, key);
+	}
+	else
+	{
+		encodex_schedule_init(&sched, key);
+
+		for (idx = 0; idx < blocks_num; idx++)
+		{
+			schedule_encode_to(&sched, &dst[idx * ENCODEX_BLOCK_SIZE_BYTES],
+					&src[idx * ENCODEX_BLOCK_SIZE_BYTES]);
+		}
+	}
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void decodex_ecb_to(uint8_t* dst, const uint8_t* src, size_t blocks_num,
+		const uint8_t* key)
+{
+	register size_t idx;
+	struct encodex_schedule sched;
+
+	if (dst == src)
+	{
+		decodex_ecb(dst, blocks_num, key);
+	}
+	else
+	{
+		encodex_schedule_init(&sched, key);
+
+		for (idx = 0; idx < blocks_num; idx++)
+		{
+			schedule_decode_to(&sched, &dst[idx * ENCODEX_BLOCK_SIZE_BYTES],
+					&src[idx * ENCODEX_BLOCK_SIZE_BYTES]);
+		}
+	}
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_cbc_to(uint8_t* dst, const uint8_t* src, size_t blocks_num,
+		const uint8_t* key)
+{
+	register size_t idx;
+	struct encodex_ctx ctx;
+
+	encodex_ctx_init(&ctx, key);
 
 	for (idx = 0; idx < blocks_num; idx++)
 	{
-		decodex_cbc_stream(&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES],
-				_key, &seed);
+		ctx_encode_cbc_to(&ctx, &dst[idx * ENCODEX_BLOCK_SIZE_BYTES],
+				&src[idx * ENCODEX_BLOCK_SIZE_BYTES]);
 	}
 }
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void decodex_cbc_to(uint8_t* dst, const uint8_t* src, size_t blocks_num,
+		const uint8_t* key)
+{
+	register size_t idx;
+	struct encodex_ctx ctx;
+
+	encodex_ctx_init(&ctx, key);
+
+	for (idx = 0; idx < blocks_num; idx++)
+	{
+		ctx_decode_cbc_to(&ctx, &dst[idx * ENCODEX_BLOCK_SIZE_BYTES],
+				&src[idx * ENCODEX_BLOCK_SIZE_BYTES]);
+	}
+}
+
+#ifdef ENCODEX_PROFILE
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_profile_snapshot(struct encodex_profile* snapshot)
+{
+	*snapshot = profile;
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+void encodex_profile_reset(void)
+{
+	register size_t idx;
+
+	for (idx = 0; idx < (size_t)ENCODEX_PROFILE_STAGES; idx++)
+	{
+		profile.stage[idx].calls = 0;
+		profile.stage[idx].bytes = 0;
+		profile.stage[idx].cycles = 0;
+	}
+}
+
+/* cppcheck-suppress unusedFunction */
+/* cppcheck-suppress misra-c2012-8.7 */
+const char* encodex_profile_name(enum encodex_profile_stage stage)
+{
+	const char* res;
+
+	switch (stage)
+	{
+		case ENCODEX_PROFILE_ROL: res = "rol_block"; break;
+		case ENCODEX_PROFILE_ADD: res = "add_key"; break;
+		case ENCODEX_PROFILE_NOIZE: res = "noize"; break;
+		case ENCODEX_PROFILE_SHUFFLE: res = "shuffle"; break;
+		case ENCODEX_PROFILE_REVERT_ROL: res = "revert_rol_block"; break;
+		case ENCODEX_PROFILE_REVERT_ADD: res = "revert_add_key"; break;
+		case ENCODEX_PROFILE_REVERT_NOIZE: res = "revert_noize"; break;
+		case ENCODEX_PROFILE_REVERT_SHUFFLE: res = "revert_shuffle"; break;
+		case ENCODEX_PROFILE_CBC: res = "cbc"; break;
+		case ENCODEX_PROFILE_SCHEDULE: res = "schedule"; break;
+		default: res = "unknown"; break;
+	}
+
+	return res;
+}
+
+#endif /* ENCODEX_PROFILE */
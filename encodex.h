@@ -31,8 +31,75 @@ extern "C" {
 /** \brief Size of the key in bytes */
 #define ENCODEX_KEY_SIZE_BYTES 32u
 
-/** \brief Size of the memory block in bytes */
+/** \brief Size of the memory block in bytes. May be defined at compile time
+ *         as 32, 64, 128 or 256, the blocks longer than the key reuse the key
+ *         bytes cyclically. The default one is compatible with the previous
+ *         releases, the data encrypted with different sizes is not
+ *         compatible. */
+#ifndef ENCODEX_BLOCK_SIZE_BYTES
 #define ENCODEX_BLOCK_SIZE_BYTES ENCODEX_KEY_SIZE_BYTES
+#endif /* ENCODEX_BLOCK_SIZE_BYTES */
+
+#if (ENCODEX_BLOCK_SIZE_BYTES != 32) && (ENCODEX_BLOCK_SIZE_BYTES != 64) \
+	&& (ENCODEX_BLOCK_SIZE_BYTES != 128) && (ENCODEX_BLOCK_SIZE_BYTES != 256)
+#error "ENCODEX_BLOCK_SIZE_BYTES should be 32, 64, 128 or 256"
+#endif /* ENCODEX_BLOCK_SIZE_BYTES */
+
+/** \brief Key schedule. Holds everything that depends only on the key, so
+ *         the blocks encrypted with the same key skip the key processing. */
+struct encodex_schedule
+{
+	/** \brief The key bytes added to the block, the first
+	 *         ENCODEX_KEY_SIZE_BYTES of them are the key itself. */
+	uint8_t key[ENCODEX_BLOCK_SIZE_BYTES];
+
+	/** \brief Cyclic rotation of each byte of the block. */
+	uint8_t rol[ENCODEX_BLOCK_SIZE_BYTES];
+
+	/** \brief Pseudo-random sequence XOR-ed with the block. */
+	uint8_t noize[ENCODEX_BLOCK_SIZE_BYTES];
+
+	/** \brief Net permutation of the shuffle, the byte idx of the encrypted
+	 *         block comes from the byte perm[idx]. */
+	uint8_t perm[ENCODEX_BLOCK_SIZE_BYTES];
+
+	/** \brief Inverse of the perm permutation. */
+	uint8_t inv_perm[ENCODEX_BLOCK_SIZE_BYTES];
+};
+
+/** \brief Encoding and decoding context. Keeps all the state between calls,
+ *         the library has no hidden globals, so different contexts may be
+ *         used concurrently. */
+struct encodex_ctx
+{
+	/** \brief The key schedule of the key given on initialization. */
+	struct encodex_schedule schedule;
+
+	/** \brief The current key of the cypher block chain. */
+	uint8_t chain[ENCODEX_KEY_SIZE_BYTES];
+
+	/** \brief The current seed of the cypher block chain. */
+	uint32_t seed;
+
+	/** \brief The bytes kept by the update functions until a block is
+	 *         complete. */
+	uint8_t buf[ENCODEX_BLOCK_SIZE_BYTES];
+
+	/** \brief Number of the bytes in the buf. */
+	size_t buf_len;
+};
+
+/** \brief Segment of the memory for the scatter-gather functions. The layout
+ *         is the same as the POSIX struct iovec has, so an array of them may
+ *         be passed with a cast. */
+struct encodex_iovec
+{
+	/** \brief Start of the segment. */
+	void* iov_base;
+
+	/** \brief Size of the segment in bytes. */
+	size_t iov_len;
+};
 
 /** \brief Encodes a single memory block with a given key.
  *  \param block Valid pointer to the block of memory. This memory would be
@@ -54,6 +121,36 @@ void encodex(uint8_t* block, const uint8_t* key);
  *             with the encryption key. */
 void decodex(uint8_t* block, const uint8_t* key);
 
+/** \brief Encodes a multiple memory blocks followed one-by-one with a given
+ *         key, each block independently. The result is the same as the
+ *         encodex function call for each block, but the key is processed
+ *         only once.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                encrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be proportional
+ *                to the ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of blocks stored in the memory provided by the
+ *                    blocks parameter.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. This memory should be initialized
+ *             with the encryption key. */
+void encodex_ecb(uint8_t* blocks, size_t blocks_num, const uint8_t* key);
+
+/** \brief Decodes a multiple memory blocks followed one-by-one with a given
+ *         key, each block independently. The result is the same as the
+ *         decodex function call for each block, but the key is processed
+ *         only once.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                decrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be proportional
+ *                to the ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of blocks stored in the memory provided by the
+ *                    blocks parameter.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. This memory should be initialized
+ *             with the encryption key. */
+void decodex_ecb(uint8_t* blocks, size_t blocks_num, const uint8_t* key);
+
 /** \brief Encodes a multiple memory blocks followed one-by-one with a given
  *         key using cypher block chaining algorithm.
  *  \param blocks Valid pointer to the blocks of memory. This memory would be
@@ -80,6 +177,70 @@ void encodex_cbc(uint8_t* blocks, size_t blocks_num, const uint8_t* key);
  *             with the encryption key */
 void decodex_cbc(uint8_t* blocks, size_t blocks_num, const uint8_t* key);
 
+/** \brief Same as encodex_ecb, but reads the blocks from the src and writes
+ *         the result to the dst in a single pass.
+ *  \param dst Valid pointer to the memory for the encrypted blocks. The size of
+ *             the memory should be equal to blocks_num *
+ *             ENCODEX_BLOCK_SIZE_BYTES. May be equal to the src, otherwise
+ *             should not overlap with it.
+ *  \param src Valid pointer to the blocks to encrypt, the memory is not
+ *             modified. The size of the memory should be equal to blocks_num *
+ *             ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of the blocks.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. This memory should be initialized
+ *             with the encryption key. */
+void encodex_ecb_to(uint8_t* dst, const uint8_t* src, size_t blocks_num,
+		const uint8_t* key);
+
+/** \brief Same as decodex_ecb, but reads the blocks from the src and writes
+ *         the result to the dst in a single pass.
+ *  \param dst Valid pointer to the memory for the decrypted blocks. The size of
+ *             the memory should be equal to blocks_num *
+ *             ENCODEX_BLOCK_SIZE_BYTES. May be equal to the src, otherwise
+ *             should not overlap with it.
+ *  \param src Valid pointer to the blocks to decrypt, the memory is not
+ *             modified. The size of the memory should be equal to blocks_num *
+ *             ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of the blocks.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. This memory should be initialized
+ *             with the encryption key. */
+void decodex_ecb_to(uint8_t* dst, const uint8_t* src, size_t blocks_num,
+		const uint8_t* key);
+
+/** \brief Same as encodex_cbc, but reads the blocks from the src and writes
+ *         the result to the dst in a single pass.
+ *  \param dst Valid pointer to the memory for the encrypted blocks. The size of
+ *             the memory should be equal to blocks_num *
+ *             ENCODEX_BLOCK_SIZE_BYTES. May be equal to the src, otherwise
+ *             should not overlap with it.
+ *  \param src Valid pointer to the blocks to encrypt, the memory is not
+ *             modified. The size of the memory should be equal to blocks_num *
+ *             ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of the blocks.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. This memory should be initialized
+ *             with the encryption key. */
+void encodex_cbc_to(uint8_t* dst, const uint8_t* src, size_t blocks_num,
+		const uint8_t* key);
+
+/** \brief Same as decodex_cbc, but reads the blocks from the src and writes
+ *         the result to the dst in a single pass.
+ *  \param dst Valid pointer to the memory for the decrypted blocks. The size of
+ *             the memory should be equal to blocks_num *
+ *             ENCODEX_BLOCK_SIZE_BYTES. May be equal to the src, otherwise
+ *             should not overlap with it.
+ *  \param src Valid pointer to the blocks to decrypt, the memory is not
+ *             modified. The size of the memory should be equal to blocks_num *
+ *             ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of the blocks.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. This memory should be initialized
+ *             with the encryption key. */
+void decodex_cbc_to(uint8_t* dst, const uint8_t* src, size_t blocks_num,
+		const uint8_t* key);
+
 /** \brief Initializes the encoding and decoding stream context. Should be
  *         called before first call of encodex_cbc_stream or decodex_cbc_stream
  *         functions.
@@ -120,6 +281,274 @@ void encodex_cbc_stream(uint8_t* block, uint8_t* key, uint32_t* seed);
  *              memory by this pointer */
 void decodex_cbc_stream(uint8_t* block, uint8_t* key, uint32_t* seed);
 
+/** \brief Builds the key schedule for a given key. The schedule may be used
+ *         for any number of blocks and shared between threads.
+ *  \param sched Valid pointer to the schedule. This memory may be
+ *               uninitialized and would be overwritten after this function
+ *               call.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. This memory should be initialized
+ *             with the encryption key. */
+void encodex_schedule_init(struct encodex_schedule* sched, const uint8_t* key);
+
+/** \brief Builds the byte permutation of the shuffle stage for a given key,
+ *         the same one encodex_schedule_init puts into the schedule.
+ *  \param perm Valid pointer to the memory for the permutation, the encoded
+ *              byte idx is taken from the byte perm[idx]. The size of the
+ *              memory should be equal to ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param inv_perm Valid pointer to the memory for the inverse permutation.
+ *                  The size of the memory should be equal to
+ *                  ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. */
+void encodex_schedule_perm(uint8_t* perm, uint8_t* inv_perm,
+		const uint8_t* key);
+
+/** \brief Encodes a single memory block with a given key schedule. The result
+ *         is the same as the encodex function gives with the same key.
+ *  \param sched Valid pointer to the initialized key schedule.
+ *  \param block Valid pointer to the block of memory. This memory would be
+ *               encrypted and the new data would be written here instead of
+ *               the old one. The size of the memory should be equal to
+ *               ENCODEX_BLOCK_SIZE_BYTES. */
+void encodex_schedule_encode(const struct encodex_schedule* sched,
+		uint8_t* block);
+
+/** \brief Decodes a single memory block with a given key schedule. The result
+ *         is the same as the decodex function gives with the same key.
+ *  \param sched Valid pointer to the initialized key schedule.
+ *  \param block Valid pointer to the block of memory. This memory would be
+ *               decrypted and the new data would be written here instead of
+ *               the old one. The size of the memory should be equal to
+ *               ENCODEX_BLOCK_SIZE_BYTES. */
+void encodex_schedule_decode(const struct encodex_schedule* sched,
+		uint8_t* block);
+
+/** \brief Initializes the context with a given key. Should be called before
+ *         any other call with the same context. Calling it again restarts
+ *         the cypher block chain.
+ *  \param ctx Valid pointer to the context. This memory may be uninitialized
+ *             and would be overwritten after this function call.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. This memory should be initialized
+ *             with the encryption key. */
+void encodex_ctx_init(struct encodex_ctx* ctx, const uint8_t* key);
+
+/** \brief Encodes a single memory block with the key of the context.
+ *  \param ctx Valid pointer to the initialized context.
+ *  \param block Valid pointer to the block of memory. This memory would be
+ *               encrypted and the new data would be written here instead of
+ *               the old one. The size of the memory should be equal to
+ *               ENCODEX_BLOCK_SIZE_BYTES. */
+void encodex_ctx_encode(const struct encodex_ctx* ctx, uint8_t* block);
+
+/** \brief Decodes a single memory block with the key of the context.
+ *  \param ctx Valid pointer to the initialized context.
+ *  \param block Valid pointer to the block of memory. This memory would be
+ *               decrypted and the new data would be written here instead of
+ *               the old one. The size of the memory should be equal to
+ *               ENCODEX_BLOCK_SIZE_BYTES. */
+void encodex_ctx_decode(const struct encodex_ctx* ctx, uint8_t* block);
+
+/** \brief Encodes a multiple memory blocks followed one-by-one using cypher
+ *         block chaining algorithm. The chain continues from the previous
+ *         call with the same context.
+ *  \param ctx Valid pointer to the initialized context. This function updates
+ *             the chain state of the context.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                encrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be proportional
+ *                to the ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of blocks stored in the memory provided by the
+ *                    blocks parameter. */
+void encodex_ctx_encode_cbc(struct encodex_ctx* ctx, uint8_t* blocks,
+		size_t blocks_num);
+
+/** \brief Decodes a multiple memory blocks followed one-by-one using cypher
+ *         block chaining algorithm. The chain continues from the previous
+ *         call with the same context.
+ *  \param ctx Valid pointer to the initialized context. This function updates
+ *             the chain state of the context.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                decrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be proportional
+ *                to the ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of blocks stored in the memory provided by the
+ *                    blocks parameter. */
+void encodex_ctx_decode_cbc(struct encodex_ctx* ctx, uint8_t* blocks,
+		size_t blocks_num);
+
+/** \brief Moves the cypher block chain of the context to the given block.
+ *         The chain keys depend only on the initial key and the block
+ *         number, so the position is computed directly, the time grows with
+ *         the logarithm of the block number.
+ *  \param ctx Valid pointer to the initialized context. This function updates
+ *             the chain state of the context.
+ *  \param block_index Number of the block, counting from 0, that the next
+ *                     encodex_ctx_encode_cbc or encodex_ctx_decode_cbc call
+ *                     with this context would process first. */
+void encodex_cbc_seek(struct encodex_ctx* ctx, size_t block_index);
+
+/** \brief Encodes the memory of the segments in place with the cypher block
+ *         chain of the context. The segments are treated as one contiguous
+ *         buffer, the blocks may cross the segment edges and the chain
+ *         continues through them and through the calls with the context.
+ *  \param ctx Valid pointer to the initialized context.
+ *  \param iov Valid pointer to the segments, may be NULL if the iov_num is 0.
+ *              The total size should be a multiple of the
+ *              ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param iov_num Number of the segments.
+ *  \return 0 on success, -1 if the total size is not a multiple of the
+ *          ENCODEX_BLOCK_SIZE_BYTES, the segments and the context are left
+ *          unchanged then. */
+int encodex_cbc_iov(struct encodex_ctx* ctx,
+		const struct encodex_iovec* iov, size_t iov_num);
+
+/** \brief Decodes the memory of the segments in place with the cypher block
+ *         chain of the context, see encodex_cbc_iov.
+ *  \param ctx Valid pointer to the initialized context.
+ *  \param iov Valid pointer to the segments, may be NULL if the iov_num is 0.
+ *              The total size should be a multiple of the
+ *              ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param iov_num Number of the segments.
+ *  \return 0 on success, -1 if the total size is not a multiple of the
+ *          ENCODEX_BLOCK_SIZE_BYTES, the segments and the context are left
+ *          unchanged then. */
+int decodex_cbc_iov(struct encodex_ctx* ctx,
+		const struct encodex_iovec* iov, size_t iov_num);
+
+/** \brief Encodes the data of any length with the cypher block chain of the
+ *         context. The complete blocks are encrypted straight from the input
+ *         memory, the rest is kept in the context until the next call.
+ *  \param ctx Valid pointer to the initialized context.
+ *  \param in Valid pointer to the data, may be NULL if the len is 0.
+ *  \param len Number of the bytes of the data.
+ *  \param out Valid pointer to the memory for the encrypted blocks. The size
+ *             of the memory should be at least len + ENCODEX_BLOCK_SIZE_BYTES
+ *             - 1. May be equal to the in if every previous call with this
+ *             context was given a multiple of ENCODEX_BLOCK_SIZE_BYTES,
+ *             otherwise should not overlap with the in memory.
+ *  \return Number of the bytes written to the out, a multiple of
+ *          ENCODEX_BLOCK_SIZE_BYTES. */
+size_t encodex_cbc_update(struct encodex_ctx* ctx, const uint8_t* in,
+		size_t len, uint8_t* out);
+
+/** \brief Pads the data kept by encodex_cbc_update and encodes the last
+ *         block. The padding is from 1 to ENCODEX_BLOCK_SIZE_BYTES bytes, all
+ *         equal to their number modulo 256, so a complete block of padding is
+ *         added if no data is kept.
+ *  \param ctx Valid pointer to the context.
+ *  \param out Valid pointer to the memory for the last block. The size of the
+ *             memory should be equal to ENCODEX_BLOCK_SIZE_BYTES.
+ *  \return Number of the bytes written, always ENCODEX_BLOCK_SIZE_BYTES. */
+size_t encodex_cbc_final(struct encodex_ctx* ctx, uint8_t* out);
+
+/** \brief Decodes the data produced by encodex_cbc_update and
+ *         encodex_cbc_final, given in pieces of any length. The last block is
+ *         kept in the context until decodex_cbc_final, because it holds the
+ *         padding.
+ *  \param ctx Valid pointer to the initialized context.
+ *  \param in Valid pointer to the encrypted data, may be NULL if the len
+ *            is 0.
+ *  \param len Number of the bytes of the data.
+ *  \param out Valid pointer to the memory for the decrypted blocks. The size
+ *             of the memory should be at least len + ENCODEX_BLOCK_SIZE_BYTES.
+ *             Should not overlap with the in memory.
+ *  \return Number of the bytes written to the out, a multiple of
+ *          ENCODEX_BLOCK_SIZE_BYTES. */
+size_t decodex_cbc_update(struct encodex_ctx* ctx, const uint8_t* in,
+		size_t len, uint8_t* out);
+
+/** \brief Decodes the last block kept by decodex_cbc_update and strips the
+ *         padding.
+ *  \param ctx Valid pointer to the context.
+ *  \param out Valid pointer to the memory for the rest of the data. The size
+ *             of the memory should be equal to ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param out_len Valid pointer to the number of the bytes written to the
+ *                 out, set on success.
+ *  \return 0 on success, -1 if the data is not a multiple of the block size
+ *          or the padding is wrong. */
+int decodex_cbc_final(struct encodex_ctx* ctx, uint8_t* out, size_t* out_len);
+
+#ifdef ENCODEX_PROFILE
+
+/** \brief Instrumented parts of the algorithm. */
+enum encodex_profile_stage
+{
+	/** \brief The rotation stage of encodex. */
+	ENCODEX_PROFILE_ROL = 0,
+
+	/** \brief The key addition stage of encodex. */
+	ENCODEX_PROFILE_ADD = 1,
+
+	/** \brief The pseudo-random noise stage of encodex. */
+	ENCODEX_PROFILE_NOIZE = 2,
+
+	/** \brief The shuffle stage of encodex. */
+	ENCODEX_PROFILE_SHUFFLE = 3,
+
+	/** \brief The rotation stage of decodex. */
+	ENCODEX_PROFILE_REVERT_ROL = 4,
+
+	/** \brief The key subtraction stage of decodex. */
+	ENCODEX_PROFILE_REVERT_ADD = 5,
+
+	/** \brief The pseudo-random noise stage of decodex. */
+	ENCODEX_PROFILE_REVERT_NOIZE = 6,
+
+	/** \brief The shuffle stage of decodex. */
+	ENCODEX_PROFILE_REVERT_SHUFFLE = 7,
+
+	/** \brief A step of the cypher block chain, the bytes are the key
+	 *         bytes updated. */
+	ENCODEX_PROFILE_CBC = 8,
+
+	/** \brief The key schedule initialization, the bytes are the key bytes
+	 *         processed. */
+	ENCODEX_PROFILE_SCHEDULE = 9,
+
+	/** \brief Number of the stages. */
+	ENCODEX_PROFILE_STAGES = 10
+};
+
+/** \brief Counters of a single stage. */
+struct encodex_profile_counter
+{
+	/** \brief Number of the stage runs. */
+	uint64_t calls;
+
+	/** \brief Number of the bytes processed. */
+	uint64_t bytes;
+
+	/** \brief Time spent, in the TSC cycles on x86 with GCC compatible
+	 *         compilers, in the clock() ticks elsewhere. */
+	uint64_t cycles;
+};
+
+/** \brief Snapshot of all the counters. */
+struct encodex_profile
+{
+	/** \brief The counters indexed by enum encodex_profile_stage. */
+	struct encodex_profile_counter stage[ENCODEX_PROFILE_STAGES];
+};
+
+/** \brief Copies the counters of the calling thread. Each thread has its own
+ *         counters where the compiler has thread-local storage (C11 or GCC
+ *         compatible), elsewhere the counters are shared and are valid only
+ *         while a single thread runs the algorithm.
+ *  \param profile Valid pointer to the memory for the counters. */
+void encodex_profile_snapshot(struct encodex_profile* profile);
+
+/** \brief Sets all the counters of the calling thread to zero. */
+void encodex_profile_reset(void);
+
+/** \brief Returns the name of the stage.
+ *  \param stage The stage.
+ *  \return Static null-terminated string. */
+const char* encodex_profile_name(enum encodex_profile_stage stage);
+
+#endif /* ENCODEX_PROFILE */
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,456 @@
+/* Copyright © 2025 Artem Shapovalov <artem_shapovalov@aol.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of  this  software and associated documentation files  (the “Software”),  to
+ * deal  in the Software without restriction, including without limitation  the
+ * rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell  copies of the Software, and to permit persons to whom the Software  is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The  above copyright notice and this permission notice shall be included  in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE  SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS  OR
+ * IMPLIED,  INCLUDING  BUT NOT LIMITED TO THE WARRANTIES  OF  MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL  THE
+ * AUTHORS  OR  COPYRIGHT  HOLDERS BE LIABLE FOR ANY CLAIM,  DAMAGES  OR  OTHER
+ * LIABILITY,  WHETHER  IN AN ACTION OF CONTRACT, TORT  OR  OTHERWISE,  ARISING
+ * FROM,  OUT  OF  OR  IN CONNECTION WITH THE SOFTWARE  OR  THE  USE  OR  OTHER
+ * DEALINGS IN THE SOFTWARE. */
+
+#include "encodex_cache.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** \brief The reference counts are dropped without the shard lock where the
+ *         compiler has atomic builtins, so a hit locks the shard once. They
+ *         are still raised and checked under the lock, which keeps an entry
+ *         with references from being evicted. */
+#if defined(__GNUC__)
+#define CACHE_ATOMIC_REFS
+#define CACHE_REFS_ADD(refs) ((void)__atomic_add_fetch(&(refs), 1u, \
+			__ATOMIC_RELAXED))
+#define CACHE_REFS_SUB(refs) ((void)__atomic_sub_fetch(&(refs), 1u, \
+			__ATOMIC_RELEASE))
+#define CACHE_REFS_LOAD(refs) __atomic_load_n(&(refs), __ATOMIC_ACQUIRE)
+#else
+#define CACHE_REFS_ADD(refs) ((void)((refs)++))
+#define CACHE_REFS_SUB(refs) ((void)((refs)--))
+#define CACHE_REFS_LOAD(refs) (refs)
+#endif /* __GNUC__ */
+
+/** \brief The entry holds no key. */
+#define CACHE_EMPTY 0
+
+/** \brief The key is claimed and its schedule is being built outside the
+ *         lock, the lookups of the key wait for it. */
+#define CACHE_BUILDING 1
+
+/** \brief The schedule of the key is ready. */
+#define CACHE_READY 2
+
+/** \brief A single cached key. */
+struct cache_entry
+{
+	/** \brief The public part, should be the first member, so the pointer
+	 *         handed out is the pointer to the entry. */
+	struct encodex_cached_schedule pub;
+
+	/** \brief Hash of the key. */
+	uint32_t hash;
+
+	/** \brief CACHE_EMPTY, CACHE_BUILDING or CACHE_READY. */
+	int state;
+
+	/** \brief Number of the acquisitions not released yet. */
+	size_t refs;
+
+	/** \brief The next entry in the same hash bucket. */
+	struct cache_entry* bucket_next;
+
+	/** \brief The more recently used neighbour. */
+	struct cache_entry* prev;
+
+	/** \brief The less recently used neighbour. */
+	struct cache_entry* next;
+};
+
+/** \brief An independently locked part of the cache. */
+struct cache_shard
+{
+	/** \brief Protects everything below. */
+	pthread_mutex_t lock;
+
+	/** \brief Signaled when an entry of the shard becomes ready. */
+	pthread_cond_t ready;
+
+	/** \brief All the entries of the shard. */
+	struct cache_entry* entries;
+
+	/** \brief Heads of the hash bucket lists. */
+	struct cache_entry** buckets;
+
+	/** \brief Number of the buckets, the power of 2. */
+	size_t buckets_num;
+
+	/** \brief The most recently used entry. */
+	struct cache_entry* head;
+
+	/** \brief The least recently used entry. */
+	struct cache_entry* tail;
+
+	/** \brief Number of the lookups that found the key. */
+	size_t hits;
+
+	/** \brief Number of the lookups that did not find the key. */
+	size_t misses;
+};
+
+struct encodex_schedule_cache
+{
+	/** \brief The shards, chosen by the low bits of the key hash. */
+	struct cache_shard shards[ENCODEX_CACHE_SHARDS];
+
+	/** \brief Number of the initialized shards. */
+	size_t shards_num;
+};
+
+/** \brief FNV-1a hash of the key. The low bits of FNV-1a depend only on the
+ *         low bits of the key bytes, so the hash is mixed at the end before
+ *         its low bits pick the shard.
+ *  \param key Valid pointer to the key.
+ *  \return The hash. */
+static uint32_t cache_hash(const uint8_t* key)
+{
+	register size_t idx;
+	uint32_t hash;
+
+	hash = 2166136261u;
+
+	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+	{
+		hash = (hash ^ key[idx]) * 16777619u;
+	}
+
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+/** \brief Returns the bucket of the hash in the shard.
+ *  \param shard Valid pointer to the shard.
+ *  \param hash Hash of the key.
+ *  \return Valid pointer to the head of the bucket list. */
+static struct cache_entry** cache_bucket(struct cache_shard* shard,
+		uint32_t hash)
+{
+	return &shard->buckets[(hash / ENCODEX_CACHE_SHARDS)
+		& (shard->buckets_num - 1u)];
+}
+
+/** \brief Unlinks the entry from the LRU list.
+ *  \param shard Valid pointer to the shard.
+ *  \param entry Valid pointer to the entry in the list. */
+static void cache_unlink(struct cache_shard* shard, struct cache_entry* entry)
+{
+	if (entry->prev != NULL)
+	{
+		entry->prev->next = entry->next;
+	}
+	else
+	{
+		shard->head = entry->next;
+	}
+
+	if (entry->next != NULL)
+	{
+		entry->next->prev = entry->prev;
+	}
+	else
+	{
+		shard->tail = entry->prev;
+	}
+}
+
+/** \brief Makes the entry the most recently used one.
+ *  \param shard Valid pointer to the shard.
+ *  \param entry Valid pointer to the entry in the list. */
+static void cache_touch(struct cache_shard* shard, struct cache_entry* entry)
+{
+	if (shard->head != entry)
+	{
+		cache_unlink(shard, entry);
+		entry->prev = NULL;
+		entry->next = shard->head;
+		shard->head->prev = entry;
+		shard->head = entry;
+	}
+}
+
+/** \brief Removes the entry from its hash bucket.
+ *  \param shard Valid pointer to the shard.
+ *  \param entry Valid pointer to the used entry. */
+static void cache_evict(struct cache_shard* shard, struct cache_entry* entry)
+{
+	struct cache_entry** link;
+
+	link = cache_bucket(shard, entry->hash);
+
+	while (*link != entry)
+	{
+		link = &(*link)->bucket_next;
+	}
+
+	*link = entry->bucket_next;
+	entry->state = CACHE_EMPTY;
+}
+
+/** \brief Allocates and links the entries of the shard.
+ *  \param shard Valid pointer to the shard.
+ *  \param entries_num Number of the entries, not 0.
+ *  \return 0 on success, -1 otherwise. */
+static int cache_shard_init(struct cache_shard* shard, size_t entries_num)
+{
+	register size_t idx;
+	int res;
+
+	shard->buckets_num = 1;
+	while (shard->buckets_num < entries_num)
+	{
+		shard->buckets_num *= 2u;
+	}
+
+	shard->entries = (struct cache_entry*)calloc(entries_num,
+			sizeof(*shard->entries));
+	shard->buckets = (struct cache_entry**)calloc(shard->buckets_num,
+			sizeof(*shard->buckets));
+	shard->hits = 0;
+	shard->misses = 0;
+
+	res = ((shard->entries == NULL) || (shard->buckets == NULL)
+			|| (pthread_mutex_init(&shard->lock, NULL) != 0)) ? -1 : 0;
+
+	if ((res == 0) && (pthread_cond_init(&shard->ready, NULL) != 0))
+	{
+		(void)pthread_mutex_destroy(&shard->lock);
+		res = -1;
+	}
+
+	if (res != 0)
+	{
+		free(shard->entries);
+		free(shard->buckets);
+	}
+	else
+	{
+		for (idx = 0; idx < entries_num; idx++)
+		{
+			shard->entries[idx].state = CACHE_EMPTY;
+			shard->entries[idx].refs = 0;
+			shard->entries[idx].bucket_next = NULL;
+			shard->entries[idx].prev = (idx > 0u)
+				? &shard->entries[idx - 1u] : NULL;
+			shard->entries[idx].next = (idx < (entries_num - 1u))
+				? &shard->entries[idx + 1u] : NULL;
+		}
+
+		shard->head = &shard->entries[0];
+		shard->tail = &shard->entries[entries_num - 1u];
+	}
+
+	return res;
+}
+
+struct encodex_schedule_cache* encodex_schedule_cache_create(size_t capacity)
+{
+	struct encodex_schedule_cache* cache;
+	size_t entries_num;
+
+	entries_num = (capacity + ENCODEX_CACHE_SHARDS - 1u)
+		/ ENCODEX_CACHE_SHARDS;
+	if (entries_num == 0u)
+	{
+		entries_num = 1;
+	}
+
+	cache = (struct encodex_schedule_cache*)malloc(sizeof(*cache));
+
+	if (cache != NULL)
+	{
+		cache->shards_num = 0;
+
+		while ((cache->shards_num < ENCODEX_CACHE_SHARDS)
+				&& (cache_shard_init(&cache->shards[cache->shards_num],
+						entries_num) == 0))
+		{
+			cache->shards_num++;
+		}
+
+		if (cache->shards_num < ENCODEX_CACHE_SHARDS)
+		{
+			encodex_schedule_cache_destroy(cache);
+			cache = NULL;
+		}
+	}
+
+	return cache;
+}
+
+void encodex_schedule_cache_destroy(struct encodex_schedule_cache* cache)
+{
+	register size_t idx;
+
+	if (cache != NULL)
+	{
+		for (idx = 0; idx < cache->shards_num; idx++)
+		{
+			(void)pthread_cond_destroy(&cache->shards[idx].ready);
+			(void)pthread_mutex_destroy(&cache->shards[idx].lock);
+			free(cache->shards[idx].entries);
+			free(cache->shards[idx].buckets);
+		}
+
+		free(cache);
+	}
+}
+
+const struct encodex_cached_schedule* encodex_schedule_cache_acquire(
+		struct encodex_schedule_cache* cache, const uint8_t* key)
+{
+	struct cache_shard* shard;
+	struct cache_entry* entry;
+	uint32_t hash;
+	int build;
+
+	hash = cache_hash(key);
+	shard = &cache->shards[hash % ENCODEX_CACHE_SHARDS];
+	build = 0;
+
+	(void)pthread_mutex_lock(&shard->lock);
+
+	entry = *cache_bucket(shard, hash);
+	while ((entry != NULL) && ((entry->hash != hash)
+				|| (memcmp(entry->pub.key, key,
+						ENCODEX_KEY_SIZE_BYTES) != 0)))
+	{
+		entry = entry->bucket_next;
+	}
+
+	if (entry != NULL)
+	{
+		shard->hits++;
+	}
+	else
+	{
+		shard->misses++;
+
+		/* The least recently used entry nobody holds. */
+		entry = shard->tail;
+		while ((entry != NULL) && (CACHE_REFS_LOAD(entry->refs) != 0u))
+		{
+			entry = entry->prev;
+		}
+
+		if (entry != NULL)
+		{
+			struct cache_entry** bucket;
+
+			if (entry->state != CACHE_EMPTY)
+			{
+				cache_evict(shard, entry);
+			}
+
+			/* The key is claimed now, the schedule is built after the
+			 * unlock. */
+			memcpy(entry->pub.key, key, ENCODEX_KEY_SIZE_BYTES);
+
+			bucket = cache_bucket(shard, hash);
+			entry->hash = hash;
+			entry->state = CACHE_BUILDING;
+			entry->bucket_next = *bucket;
+			*bucket = entry;
+			build = 1;
+		}
+		else
+		{
+		}
+	}
+
+	if (entry != NULL)
+	{
+		CACHE_REFS_ADD(entry->refs);
+		cache_touch(shard, entry);
+	}
+
+	if (build != 0)
+	{
+		(void)pthread_mutex_unlock(&shard->lock);
+
+		encodex_schedule_init(&entry->pub.schedule, key);
+		encodex_cbc_stream_init(key, &entry->pub.seed);
+
+		(void)pthread_mutex_lock(&shard->lock);
+		entry->state = CACHE_READY;
+		(void)pthread_cond_broadcast(&shard->ready);
+	}
+	else
+	{
+		while ((entry != NULL) && (entry->state == CACHE_BUILDING))
+		{
+			(void)pthread_cond_wait(&shard->ready, &shard->lock);
+		}
+	}
+
+	(void)pthread_mutex_unlock(&shard->lock);
+
+	return (entry != NULL) ? &entry->pub : NULL;
+}
+
+void encodex_schedule_cache_release(struct encodex_schedule_cache* cache,
+		const struct encodex_cached_schedule* sched)
+{
+	struct cache_shard* shard;
+	size_t idx;
+
+	shard = &cache->shards[cache_hash(sched->key) % ENCODEX_CACHE_SHARDS];
+	idx = (size_t)((const struct cache_entry*)sched - shard->entries);
+
+#ifdef CACHE_ATOMIC_REFS
+	CACHE_REFS_SUB(shard->entries[idx].refs);
+#else
+	(void)pthread_mutex_lock(&shard->lock);
+	CACHE_REFS_SUB(shard->entries[idx].refs);
+	(void)pthread_mutex_unlock(&shard->lock);
+#endif /* CACHE_ATOMIC_REFS */
+}
+
+void encodex_schedule_cache_stats(struct encodex_schedule_cache* cache,
+		size_t* hits, size_t* misses)
+{
+	register size_t idx;
+
+	*hits = 0;
+	*misses = 0;
+
+	for (idx = 0; idx < ENCODEX_CACHE_SHARDS; idx++)
+	{
+		(void)pthread_mutex_lock(&cache->shards[idx].lock);
+		*hits += cache->shards[idx].hits;
+		*misses += cache->shards[idx].misses;
+		(void)pthread_mutex_unlock(&cache->shards[idx].lock);
+	}
+}
+
+void encodex_schedule_cache_ctx_init(struct encodex_ctx* ctx,
+		const struct encodex_cached_schedule* sched)
+{
+	ctx->schedule = sched->schedule;
+	memcpy(ctx->chain, sched->key, ENCODEX_KEY_SIZE_BYTES);
+	ctx->seed = sched->seed;
+	ctx->buf_len = 0;
+}
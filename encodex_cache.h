@@ -0,0 +1,105 @@
+/* Copyright © 2025 Artem Shapovalov <artem_shapovalov@aol.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of  this  software and associated documentation files  (the “Software”),  to
+ * deal  in the Software without restriction, including without limitation  the
+ * rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell  copies of the Software, and to permit persons to whom the Software  is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The  above copyright notice and this permission notice shall be included  in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE  SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS  OR
+ * IMPLIED,  INCLUDING  BUT NOT LIMITED TO THE WARRANTIES  OF  MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL  THE
+ * AUTHORS  OR  COPYRIGHT  HOLDERS BE LIABLE FOR ANY CLAIM,  DAMAGES  OR  OTHER
+ * LIABILITY,  WHETHER  IN AN ACTION OF CONTRACT, TORT  OR  OTHERWISE,  ARISING
+ * FROM,  OUT  OF  OR  IN CONNECTION WITH THE SOFTWARE  OR  THE  USE  OR  OTHER
+ * DEALINGS IN THE SOFTWARE. */
+
+#ifndef ENCODEX_CACHE_H
+#define ENCODEX_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "encodex.h"
+
+/** \brief Number of the independently locked parts of the cache. Each key
+ *         belongs to a single shard chosen by its hash. */
+#define ENCODEX_CACHE_SHARDS 16u
+
+/** \brief Everything precomputed for a single key. */
+struct encodex_cached_schedule
+{
+	/** \brief The key schedule. */
+	struct encodex_schedule schedule;
+
+	/** \brief The key itself, also the first key of the cypher block
+	 *         chain. */
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+
+	/** \brief The first seed of the cypher block chain. */
+	uint32_t seed;
+};
+
+/** \brief Bounded cache of the key schedules shared by several threads. The
+ *         layout is private to encodex_cache.c. */
+struct encodex_schedule_cache;
+
+/** \brief Creates the cache. All the memory is allocated here, the cache
+ *         never grows later.
+ *  \param capacity Maximum number of the cached keys. It is split between
+ *                  the shards evenly and rounded up.
+ *  \return Pointer to the new cache or NULL if there is not enough memory. */
+struct encodex_schedule_cache* encodex_schedule_cache_create(size_t capacity);
+
+/** \brief Frees the cache.
+ *  \warning All the acquired schedules should be released before.
+ *  \param cache Pointer to the cache or NULL. */
+void encodex_schedule_cache_destroy(struct encodex_schedule_cache* cache);
+
+/** \brief Finds the schedule of the key, or builds it in place of the least
+ *         recently used one which is not acquired now. The schedule is
+ *         built outside the shard lock, the other lookups of the same key
+ *         wait until it is ready. The returned schedule stays valid and
+ *         unchanged until it is released.
+ *  \param cache Valid pointer to the cache.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES.
+ *  \return Pointer to the schedule, or NULL if all the entries of the shard
+ *          are acquired. */
+const struct encodex_cached_schedule* encodex_schedule_cache_acquire(
+		struct encodex_schedule_cache* cache, const uint8_t* key);
+
+/** \brief Releases the schedule returned by encodex_schedule_cache_acquire.
+ *  \param cache Valid pointer to the cache.
+ *  \param sched Valid pointer to the acquired schedule. */
+void encodex_schedule_cache_release(struct encodex_schedule_cache* cache,
+		const struct encodex_cached_schedule* sched);
+
+/** \brief Returns the lookup statistics of the cache.
+ *  \param cache Valid pointer to the cache.
+ *  \param hits Valid pointer to the number of lookups that found the key.
+ *  \param misses Valid pointer to the number of lookups that built the
+ *                schedule or returned NULL. */
+void encodex_schedule_cache_stats(struct encodex_schedule_cache* cache,
+		size_t* hits, size_t* misses);
+
+/** \brief Initializes the context from a cached schedule, the same as
+ *         encodex_ctx_init does with the key, but without building the
+ *         schedule.
+ *  \param ctx Valid pointer to the context. This memory may be uninitialized
+ *             and would be overwritten after this function call.
+ *  \param sched Valid pointer to the acquired schedule. The context keeps a
+ *               copy, so the schedule may be released right after. */
+void encodex_schedule_cache_ctx_init(struct encodex_ctx* ctx,
+		const struct encodex_cached_schedule* sched);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* ENCODEX_CACHE_H */
@@ -0,0 +1,164 @@
+/* Copyright © 2025 Artem Shapovalov <artem_shapovalov@aol.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of  this  software and associated documentation files  (the “Software”),  to
+ * deal  in the Software without restriction, including without limitation  the
+ * rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell  copies of the Software, and to permit persons to whom the Software  is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The  above copyright notice and this permission notice shall be included  in
+ * all copies or substantial portions of the Software.
+ *
+ * THE  SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS  OR
+ * IMPLIED,  INCLUDING  BUT NOT LIMITED TO THE WARRANTIES  OF  MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL  THE
+ * AUTHORS  OR  COPYRIGHT  HOLDERS BE LIABLE FOR ANY CLAIM,  DAMAGES  OR  OTHER
+ * LIABILITY,  WHETHER  IN AN ACTION OF CONTRACT, TORT  OR  OTHERWISE,  ARISING
+ * FROM,  OUT  OF  OR  IN CONNECTION WITH THE SOFTWARE  OR  THE  USE  OR  OTHER
+ * DEALINGS IN THE SOFTWARE. */
+
+#include "encodex_mt.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+/** \brief A range of the blocks processed by a single thread. */
+struct mt_range
+{
+	/** \brief The context positioned at the first block of the range. */
+	struct encodex_ctx ctx;
+
+	/** \brief The first block of the range. */
+	uint8_t* blocks;
+
+	/** \brief Number of blocks in the range. */
+	size_t blocks_num;
+
+	/** \brief Decode if not 0, encode otherwise. */
+	int decode;
+
+	/** \brief Not 0 if the range is processed by a started thread. */
+	int started;
+
+	/** \brief The thread processing the range. */
+	pthread_t thread;
+};
+
+/** \brief Processes a single range.
+ *  \param arg Valid pointer to the mt_range.
+ *  \return Always NULL. */
+static void* mt_worker(void* arg)
+{
+	struct mt_range* range;
+
+	range = (struct mt_range*)arg;
+
+	if (range->decode != 0)
+	{
+		encodex_ctx_decode_cbc(&range->ctx, range->blocks, range->blocks_num);
+	}
+	else
+	{
+		encodex_ctx_encode_cbc(&range->ctx, range->blocks, range->blocks_num);
+	}
+
+	return NULL;
+}
+
+/** \brief Processes the ranges on the threads and waits for them.
+ *  \param ranges Valid pointer to the initialized ranges.
+ *  \param ranges_num Number of ranges, one thread per range. */
+static void mt_run(struct mt_range* ranges, size_t ranges_num)
+{
+	register size_t idx;
+
+	for (idx = 1; idx < ranges_num; idx++)
+	{
+		ranges[idx].started = (pthread_create(&ranges[idx].thread,
+				NULL, mt_worker, &ranges[idx]) == 0) ? 1 : 0;
+	}
+
+	for (idx = 0; idx < ranges_num; idx++)
+	{
+		if (ranges[idx].started == 0)
+		{
+			(void)mt_worker(&ranges[idx]);
+		}
+	}
+
+	for (idx = 1; idx < ranges_num; idx++)
+	{
+		if (ranges[idx].started != 0)
+		{
+			(void)pthread_join(ranges[idx].thread, NULL);
+		}
+	}
+}
+
+/** \brief Splits the blocks into ranges and processes them on the threads.
+ *  \param blocks Valid pointer to the blocks of memory.
+ *  \param blocks_num Number of blocks.
+ *  \param key Valid pointer to the key.
+ *  \param threads_num Number of threads, including the calling one.
+ *  \param decode Decode if not 0, encode otherwise. */
+static void mt_cbc(uint8_t* blocks, size_t blocks_num,
+		const uint8_t* key, unsigned int threads_num, int decode)
+{
+	register size_t idx;
+	size_t ranges_num;
+	size_t first;
+	struct mt_range single;
+	struct mt_range* ranges;
+
+	ranges_num = (threads_num > 0u) ? threads_num : 1u;
+	if (ranges_num > blocks_num)
+	{
+		ranges_num = (blocks_num > 0u) ? blocks_num : 1u;
+	}
+
+	ranges = NULL;
+	if (ranges_num > 1u)
+	{
+		ranges = (struct mt_range*)malloc(ranges_num * sizeof(*ranges));
+	}
+
+	if (ranges == NULL)
+	{
+		ranges = &single;
+		ranges_num = 1;
+	}
+
+	first = 0;
+	for (idx = 0; idx < ranges_num; idx++)
+	{
+		encodex_ctx_init(&ranges[idx].ctx, key);
+		encodex_cbc_seek(&ranges[idx].ctx, first);
+
+		ranges[idx].blocks = &blocks[first * ENCODEX_BLOCK_SIZE_BYTES];
+		ranges[idx].blocks_num = (blocks_num / ranges_num)
+			+ ((idx < (blocks_num % ranges_num)) ? 1u : 0u);
+		ranges[idx].decode = decode;
+		ranges[idx].started = 0;
+
+		first += ranges[idx].blocks_num;
+	}
+
+	mt_run(ranges, ranges_num);
+
+	if (ranges != &single)
+	{
+		free(ranges);
+	}
+}
+
+void encodex_cbc_parallel(uint8_t* blocks, size_t blocks_num,
+		const uint8_t* key, unsigned int threads_num)
+{
+	mt_cbc(blocks, blocks_num, key, threads_num, 0);
+}
+
+void decodex_cbc_parallel(uint8_t* blocks, size_t blocks_num,
+		const uint8_t* key, unsigned int threads_num)
+{
+	mt_cbc(blocks, blocks_num, key, threads_num, 1);
+}
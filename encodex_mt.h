@@ -0,0 +1,72 @@
+/* Copyright © 2025 Artem Shapovalov <artem_shapovalov@aol.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of  this  software and associated documentation files  (the “Software”),  to
+ * deal  in the Software without restriction, including without limitation  the
+ * rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell  copies of the Software, and to permit persons to whom the Software  is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The  above copyright notice and this permission notice shall be included  in
+ * all copies or substantial portions of the Software.
+ *
+ * THE  SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS  OR
+ * IMPLIED,  INCLUDING  BUT NOT LIMITED TO THE WARRANTIES  OF  MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL  THE
+ * AUTHORS  OR  COPYRIGHT  HOLDERS BE LIABLE FOR ANY CLAIM,  DAMAGES  OR  OTHER
+ * LIABILITY,  WHETHER  IN AN ACTION OF CONTRACT, TORT  OR  OTHERWISE,  ARISING
+ * FROM,  OUT  OF  OR  IN CONNECTION WITH THE SOFTWARE  OR  THE  USE  OR  OTHER
+ * DEALINGS IN THE SOFTWARE. */
+
+#ifndef ENCODEX_MT_H
+#define ENCODEX_MT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "encodex.h"
+
+/** \brief Encodes a multiple memory blocks followed one-by-one with a given
+ *         key using cypher block chaining algorithm on several threads. The
+ *         blocks are split into ranges, the chain state of each range is
+ *         computed with encodex_cbc_seek. The result is the same as the
+ *         encodex_cbc function gives.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                encrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be proportional
+ *                to the ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of blocks stored in the memory provided by the
+ *                    blocks parameter.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. This memory should be initialized
+ *             with the encryption key.
+ *  \param threads_num Number of threads, including the calling one. If a
+ *                     thread can't be started, its range is processed by the
+ *                     calling thread. */
+void encodex_cbc_parallel(uint8_t* blocks, size_t blocks_num,
+		const uint8_t* key, unsigned int threads_num);
+
+/** \brief Decodes a multiple memory blocks followed one-by-one with a given
+ *         key using cypher block chaining algorithm on several threads. The
+ *         result is the same as the decodex_cbc function gives.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                decrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be proportional
+ *                to the ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of blocks stored in the memory provided by the
+ *                    blocks parameter.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. This memory should be initialized
+ *             with the encryption key.
+ *  \param threads_num Number of threads, including the calling one. If a
+ *                     thread can't be started, its range is processed by the
+ *                     calling thread. */
+void decodex_cbc_parallel(uint8_t* blocks, size_t blocks_num,
+		const uint8_t* key, unsigned int threads_num);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* ENCODEX_MT_H */
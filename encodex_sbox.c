@@ -0,0 +1,111 @@
+/* Copyright © 2025 Artem Shapovalov <artem_shapovalov@aol.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of  this  software and associated documentation files  (the “Software”),  to
+ * deal  in the Software without restriction, including without limitation  the
+ * rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell  copies of the Software, and to permit persons to whom the Software  is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The  above copyright notice and this permission notice shall be included  in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE  SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS  OR
+ * IMPLIED,  INCLUDING  BUT NOT LIMITED TO THE WARRANTIES  OF  MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL  THE
+ * AUTHORS  OR  COPYRIGHT  HOLDERS BE LIABLE FOR ANY CLAIM,  DAMAGES  OR  OTHER
+ * LIABILITY,  WHETHER  IN AN ACTION OF CONTRACT, TORT  OR  OTHERWISE,  ARISING
+ * FROM,  OUT  OF  OR  IN CONNECTION WITH THE SOFTWARE  OR  THE  USE  OR  OTHER
+ * DEALINGS IN THE SOFTWARE. */
+
+#include "encodex_sbox.h"
+
+void encodex_sbox_init(struct encodex_sbox* sbox, const uint8_t* key)
+{
+	register size_t idx;
+	register unsigned int value;
+	struct encodex_schedule sched;
+
+	encodex_schedule_init(&sched, key);
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
+		register size_t from;
+		register unsigned int shift;
+
+		sbox->perm[idx] = sched.perm[idx];
+		sbox->inv_perm[idx] = sched.inv_perm[idx];
+
+		/* The encoding table of the position holds the bijection of the
+		 * source byte, the decoding one inverts the bijection of the
+		 * position itself. */
+		from = sched.perm[idx];
+		shift = sched.rol[from];
+
+		for (value = 0; value < 256u; value++)
+		{
+			sbox->encode[idx][value] = (uint8_t)(((0xffu
+							& ((value << shift) | (value >> (8u - shift))))
+						+ sched.key[from]) ^ sched.noize[from]);
+		}
+
+		shift = sched.rol[idx];
+
+		for (value = 0; value < 256u; value++)
+		{
+			sbox->decode[idx][(uint8_t)(((0xffu
+							& ((value << shift) | (value >> (8u - shift))))
+						+ sched.key[idx]) ^ sched.noize[idx])] = (uint8_t)value;
+		}
+	}
+}
+
+void encodex_sbox_encode(const struct encodex_sbox* sbox,
+		uint8_t* blocks, size_t blocks_num)
+{
+	register size_t idx;
+	register size_t block;
+	uint8_t buf[ENCODEX_BLOCK_SIZE_BYTES];
+
+	for (block = 0; block < blocks_num; block++)
+	{
+		uint8_t* data;
+
+		data = &blocks[block * ENCODEX_BLOCK_SIZE_BYTES];
+
+		for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+		{
+			buf[idx] = data[idx];
+		}
+
+		for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+		{
+			data[idx] = sbox->encode[idx][buf[sbox->perm[idx]]];
+		}
+	}
+}
+
+void encodex_sbox_decode(const struct encodex_sbox* sbox,
+		uint8_t* blocks, size_t blocks_num)
+{
+	register size_t idx;
+	register size_t block;
+	uint8_t buf[ENCODEX_BLOCK_SIZE_BYTES];
+
+	for (block = 0; block < blocks_num; block++)
+	{
+		uint8_t* data;
+
+		data = &blocks[block * ENCODEX_BLOCK_SIZE_BYTES];
+
+		for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+		{
+			buf[idx] = data[idx];
+		}
+
+		for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+		{
+			data[idx] = sbox->decode[idx][buf[sbox->inv_perm[idx]]];
+		}
+	}
+}
@@ -0,0 +1,92 @@
+/* Copyright © 2025 Artem Shapovalov <artem_shapovalov@aol.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of  this  software and associated documentation files  (the “Software”),  to
+ * deal  in the Software without restriction, including without limitation  the
+ * rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell  copies of the Software, and to permit persons to whom the Software  is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The  above copyright notice and this permission notice shall be included  in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE  SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS  OR
+ * IMPLIED,  INCLUDING  BUT NOT LIMITED TO THE WARRANTIES  OF  MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL  THE
+ * AUTHORS  OR  COPYRIGHT  HOLDERS BE LIABLE FOR ANY CLAIM,  DAMAGES  OR  OTHER
+ * LIABILITY,  WHETHER  IN AN ACTION OF CONTRACT, TORT  OR  OTHERWISE,  ARISING
+ * FROM,  OUT  OF  OR  IN CONNECTION WITH THE SOFTWARE  OR  THE  USE  OR  OTHER
+ * DEALINGS IN THE SOFTWARE. */
+
+#ifndef ENCODEX_SBOX_H
+#define ENCODEX_SBOX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "encodex.h"
+
+/** \brief Table driven engine. With a fixed key the rotation, the addition
+ *         and the noize of a byte depend only on its position, so together
+ *         they are a bijection of the byte values. Each position of the
+ *         encrypted block gets a table of 256 entries with the bijection of
+ *         its source byte, so a byte costs a single load.
+ *  \note The size is ENCODEX_BLOCK_SIZE_BYTES * 512 bytes plus the
+ *        permutations, 16 KiB with 32-byte blocks, keep it off small
+ *        stacks. */
+struct encodex_sbox
+{
+	/** \brief The byte idx of the encrypted block is
+	 *         encode[idx][block[perm[idx]]]. */
+	uint8_t encode[ENCODEX_BLOCK_SIZE_BYTES][256];
+
+	/** \brief The byte idx of the decrypted block is
+	 *         decode[idx][block[inv_perm[idx]]]. */
+	uint8_t decode[ENCODEX_BLOCK_SIZE_BYTES][256];
+
+	/** \brief Net permutation of the shuffle, the same as the key schedule
+	 *         has. */
+	uint8_t perm[ENCODEX_BLOCK_SIZE_BYTES];
+
+	/** \brief Inverse of the perm permutation. */
+	uint8_t inv_perm[ENCODEX_BLOCK_SIZE_BYTES];
+};
+
+/** \brief Builds the tables for a given key.
+ *  \param sbox Valid pointer to the tables. This memory may be uninitialized
+ *              and would be overwritten after this function call.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. This memory should be initialized
+ *             with the encryption key. */
+void encodex_sbox_init(struct encodex_sbox* sbox, const uint8_t* key);
+
+/** \brief Encodes a multiple memory blocks independently with the tables.
+ *         The result is the same as the encodex_ecb function gives.
+ *  \param sbox Valid pointer to the initialized tables.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                encrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be proportional
+ *                to the ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of blocks stored in the memory provided by the
+ *                    blocks parameter. */
+void encodex_sbox_encode(const struct encodex_sbox* sbox,
+		uint8_t* blocks, size_t blocks_num);
+
+/** \brief Decodes a multiple memory blocks independently with the tables.
+ *         The result is the same as the decodex_ecb function gives.
+ *  \param sbox Valid pointer to the initialized tables.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                decrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be proportional
+ *                to the ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of blocks stored in the memory provided by the
+ *                    blocks parameter. */
+void encodex_sbox_decode(const struct encodex_sbox* sbox,
+		uint8_t* blocks, size_t blocks_num);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* ENCODEX_SBOX_H */
@@ -0,0 +1,776 @@
+/* Copyright © 2025 Artem Shapovalov <artem_shapovalov@aol.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of  this  software and associated documentation files  (the “Software”),  to
+ * deal  in the Software without restriction, including without limitation  the
+ * rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell  copies of the Software, and to permit persons to whom the Software  is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The  above copyright notice and this permission notice shall be included  in
+ * all copies or substantial portions of the Software.
+ *
+ * THE  SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS  OR
+ * IMPLIED,  INCLUDING  BUT NOT LIMITED TO THE WARRANTIES  OF  MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL  THE
+ * AUTHORS  OR  COPYRIGHT  HOLDERS BE LIABLE FOR ANY CLAIM,  DAMAGES  OR  OTHER
+ * LIABILITY,  WHETHER  IN AN ACTION OF CONTRACT, TORT  OR  OTHERWISE,  ARISING
+ * FROM,  OUT  OF  OR  IN CONNECTION WITH THE SOFTWARE  OR  THE  USE  OR  OTHER
+ * DEALINGS IN THE SOFTWARE. */
+
+#include "encodex_simd.h"
+
+/* The kernels hold exactly one 32-byte block per 256-bit register. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+	&& (ENCODEX_BLOCK_SIZE_BYTES == 32)
+#define ENCODEX_SIMD_X86
+#include <immintrin.h>
+#endif /* __GNUC__ && x86 && 32-byte blocks */
+
+#ifdef ENCODEX_SIMD_X86
+
+/** \brief Key schedule rearranged for the vector kernels. */
+struct simd_tables
+{
+	/** \brief Multipliers 1 << rotation for the even bytes of the block. */
+	uint16_t mul_even[ENCODEX_BLOCK_SIZE_BYTES / 2u];
+
+	/** \brief Multipliers 1 << rotation for the odd bytes of the block. */
+	uint16_t mul_odd[ENCODEX_BLOCK_SIZE_BYTES / 2u];
+
+	/** \brief The key bytes added to the block. */
+	uint8_t key[ENCODEX_BLOCK_SIZE_BYTES];
+
+	/** \brief Pseudo-random sequence XOR-ed with the block. */
+	uint8_t noize[ENCODEX_BLOCK_SIZE_BYTES];
+
+	/** \brief Index of the source byte inside its 16-byte half. */
+	uint8_t ctrl[ENCODEX_BLOCK_SIZE_BYTES];
+
+	/** \brief 0xff if the source byte is in the upper half, 0 otherwise. */
+	uint8_t upper[ENCODEX_BLOCK_SIZE_BYTES];
+};
+
+/** \brief Splits a byte permutation into the in-lane index and the lane
+ *         selector used by the byte shuffle of the vector kernels.
+ *  \param ctrl Valid pointer to the memory for the in-lane indexes.
+ *  \param upper Valid pointer to the memory for the lane selectors.
+ *  \param perm Valid pointer to the permutation, the byte idx is taken from
+ *              the byte perm[idx]. */
+static void simd_permute_init(uint8_t* ctrl, uint8_t* upper,
+		const uint8_t* perm)
+{
+	register size_t idx;
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
+		ctrl[idx] = perm[idx] % 16u;
+		upper[idx] = (perm[idx] >= 16u) ? 0xffu : 0u;
+	}
+}
+
+/** \brief Rearranges the key schedule for the vector kernels.
+ *  \param tables Valid pointer to the tables. This memory may be
+ *                uninitialized and would be overwritten after this function
+ *                call.
+ *  \param sched Valid pointer to the initialized key schedule.
+ *  \param decode If not 0, prepares tables for decoding, otherwise for
+ *                encoding. */
+static void simd_tables_init(struct simd_tables* tables,
+		const struct encodex_schedule* sched, int decode)
+{
+	register size_t idx;
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
+		register uint8_t shift;
+
+		if (decode != 0)
+		{
+			shift = (uint8_t)((8u - sched->rol[idx]) % 8u);
+		}
+		else
+		{
+			shift = sched->rol[idx];
+		}
+
+		if ((idx % 2u) == 0u)
+		{
+			tables->mul_even[idx / 2u] = (uint16_t)(1u << shift);
+		}
+		else
+		{
+			tables->mul_odd[idx / 2u] = (uint16_t)(1u << shift);
+		}
+
+		tables->key[idx] = sched->key[idx];
+		tables->noize[idx] = sched->noize[idx];
+	}
+
+	simd_permute_init(tables->ctrl, tables->upper,
+			(decode != 0) ? sched->inv_perm : sched->perm);
+}
+
+/** \brief Rotates each byte left for its own amount. Each byte is widened to
+ *         16 bits and multiplied by 1 << amount, so the low byte of the
+ *         product holds the bits shifted left and the high byte holds the
+ *         bits shifted out, OR-ing them gives the rotation.
+ *  \param x The bytes to rotate.
+ *  \param mul_even Multipliers for the even bytes.
+ *  \param mul_odd Multipliers for the odd bytes.
+ *  \return The rotated bytes. */
+__attribute__((target("avx2")))
+static __m256i avx2_rol(__m256i x, __m256i mul_even, __m256i mul_odd)
+{
+	__m256i even;
+	__m256i odd;
+
+	even = _mm256_and_si256(x, _mm256_set1_epi16(0x00ff));
+	odd = _mm256_srli_epi16(x, 8);
+	even = _mm256_mullo_epi16(even, mul_even);
+	odd = _mm256_mullo_epi16(odd, mul_odd);
+	even = _mm256_and_si256(_mm256_or_si256(even,
+				_mm256_srli_epi16(even, 8)),
+			_mm256_set1_epi16(0x00ff));
+	odd = _mm256_and_si256(_mm256_or_si256(odd,
+				_mm256_slli_epi16(odd, 8)),
+			_mm256_set1_epi16((short)0xff00));
+
+	return _mm256_or_si256(even, odd);
+}
+
+/** \brief Gathers the bytes of the block across both 128-bit lanes.
+ *  \param x The block.
+ *  \param ctrl Index of the source byte inside its lane.
+ *  \param upper Selects the upper lane as the source.
+ *  \return The permutated block. */
+__attribute__((target("avx2")))
+static __m256i avx2_permute(__m256i x, __m256i ctrl, __m256i upper)
+{
+	__m256i lo;
+	__m256i hi;
+
+	lo = _mm256_permute2x128_si256(x, x, 0x00);
+	hi = _mm256_permute2x128_si256(x, x, 0x11);
+
+	return _mm256_blendv_epi8(
+			_mm256_shuffle_epi8(lo, ctrl),
+			_mm256_shuffle_epi8(hi, ctrl),
+			upper);
+}
+
+/** \brief AVX2 encoding kernel, one block per register.
+ *  \param tables Valid pointer to the encoding tables.
+ *  \param blocks Valid pointer to the blocks of memory.
+ *  \param blocks_num Number of blocks. */
+__attribute__((target("avx2")))
+static void avx2_encode(const struct simd_tables* tables,
+		uint8_t* blocks, size_t blocks_num)
+{
+	register size_t idx;
+	__m256i mul_even;
+	__m256i mul_odd;
+	__m256i key;
+	__m256i noize;
+	__m256i ctrl;
+	__m256i upper;
+
+	mul_even = _mm256_loadu_si256((const __m256i*)tables->mul_even);
+	mul_odd = _mm256_loadu_si256((const __m256i*)tables->mul_odd);
+	key = _mm256_loadu_si256((const __m256i*)tables->key);
+	noize = _mm256_loadu_si256((const __m256i*)tables->noize);
+	ctrl = _mm256_loadu_si256((const __m256i*)tables->ctrl);
+	upper = _mm256_loadu_si256((const __m256i*)tables->upper);
+
+	for (idx = 0; idx < blocks_num; idx++)
+	{
+		__m256i* block;
+		__m256i x;
+
+		block = (__m256i*)&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES];
+		x = _mm256_loadu_si256(block);
+		x = avx2_rol(x, mul_even, mul_odd);
+		x = _mm256_add_epi8(x, key);
+		x = _mm256_xor_si256(x, noize);
+		x = avx2_permute(x, ctrl, upper);
+		_mm256_storeu_si256(block, x);
+	}
+}
+
+/** \brief AVX2 decoding kernel, one block per register.
+ *  \param tables Valid pointer to the decoding tables.
+ *  \param blocks Valid pointer to the blocks of memory.
+ *  \param blocks_num Number of blocks. */
+__attribute__((target("avx2")))
+static void avx2_decode(const struct simd_tables* tables,
+		uint8_t* blocks, size_t blocks_num)
+{
+	register size_t idx;
+	__m256i mul_even;
+	__m256i mul_odd;
+	__m256i key;
+	__m256i noize;
+	__m256i ctrl;
+	__m256i upper;
+
+	mul_even = _mm256_loadu_si256((const __m256i*)tables->mul_even);
+	mul_odd = _mm256_loadu_si256((const __m256i*)tables->mul_odd);
+	key = _mm256_loadu_si256((const __m256i*)tables->key);
+	noize = _mm256_loadu_si256((const __m256i*)tables->noize);
+	ctrl = _mm256_loadu_si256((const __m256i*)tables->ctrl);
+	upper = _mm256_loadu_si256((const __m256i*)tables->upper);
+
+	for (idx = 0; idx < blocks_num; idx++)
+	{
+		__m256i* block;
+		__m256i x;
+
+		block = (__m256i*)&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES];
+		x = _mm256_loadu_si256(block);
+		x = avx2_permute(x, ctrl, upper);
+		x = _mm256_xor_si256(x, noize);
+		x = _mm256_sub_epi8(x, key);
+		x = avx2_rol(x, mul_even, mul_odd);
+		_mm256_storeu_si256(block, x);
+	}
+}
+
+/** \brief Same as avx2_rol for a 128-bit half of the block.
+ *  \param x The bytes to rotate.
+ *  \param mul_even Multipliers for the even bytes.
+ *  \param mul_odd Multipliers for the odd bytes.
+ *  \return The rotated bytes. */
+__attribute__((target("sse4.1")))
+static __m128i sse4_rol(__m128i x, __m128i mul_even, __m128i mul_odd)
+{
+	__m128i even;
+	__m128i odd;
+
+	even = _mm_and_si128(x, _mm_set1_epi16(0x00ff));
+	odd = _mm_srli_epi16(x, 8);
+	even = _mm_mullo_epi16(even, mul_even);
+	odd = _mm_mullo_epi16(odd, mul_odd);
+	even = _mm_and_si128(_mm_or_si128(even, _mm_srli_epi16(even, 8)),
+			_mm_set1_epi16(0x00ff));
+	odd = _mm_and_si128(_mm_or_si128(odd, _mm_slli_epi16(odd, 8)),
+			_mm_set1_epi16((short)0xff00));
+
+	return _mm_or_si128(even, odd);
+}
+
+/** \brief Gathers one 128-bit half of the block from both halves.
+ *  \param lo The lower half of the block.
+ *  \param hi The upper half of the block.
+ *  \param ctrl Index of the source byte inside its half.
+ *  \param upper Selects the upper half as the source.
+ *  \return The permutated half of the block. */
+__attribute__((target("sse4.1")))
+static __m128i sse4_permute(__m128i lo, __m128i hi,
+		__m128i ctrl, __m128i upper)
+{
+	return _mm_blendv_epi8(
+			_mm_shuffle_epi8(lo, ctrl),
+			_mm_shuffle_epi8(hi, ctrl),
+			upper);
+}
+
+/** \brief SSE4.1 encoding kernel, one block per two registers.
+ *  \param tables Valid pointer to the encoding tables.
+ *  \param blocks Valid pointer to the blocks of memory.
+ *  \param blocks_num Number of blocks. */
+__attribute__((target("sse4.1")))
+static void sse4_encode(const struct simd_tables* tables,
+		uint8_t* blocks, size_t blocks_num)
+{
+	register size_t idx;
+	register size_t half;
+	__m128i mul_even[2];
+	__m128i mul_odd[2];
+	__m128i key[2];
+	__m128i noize[2];
+	__m128i ctrl[2];
+	__m128i upper[2];
+
+	for (half = 0; half < 2u; half++)
+	{
+		mul_even[half] = _mm_loadu_si128(
+				(const __m128i*)&tables->mul_even[half * 8u]);
+		mul_odd[half] = _mm_loadu_si128(
+				(const __m128i*)&tables->mul_odd[half * 8u]);
+		key[half] = _mm_loadu_si128(
+				(const __m128i*)&tables->key[half * 16u]);
+		noize[half] = _mm_loadu_si128(
+				(const __m128i*)&tables->noize[half * 16u]);
+		ctrl[half] = _mm_loadu_si128(
+				(const __m128i*)&tables->ctrl[half * 16u]);
+		upper[half] = _mm_loadu_si128(
+				(const __m128i*)&tables->upper[half * 16u]);
+	}
+
+	for (idx = 0; idx < blocks_num; idx++)
+	{
+		__m128i* block;
+		__m128i x[2];
+
+		block = (__m128i*)&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES];
+
+		for (half = 0; half < 2u; half++)
+		{
+			x[half] = _mm_loadu_si128(&block[half]);
+			x[half] = sse4_rol(x[half], mul_even[half], mul_odd[half]);
+			x[half] = _mm_add_epi8(x[half], key[half]);
+			x[half] = _mm_xor_si128(x[half], noize[half]);
+		}
+
+		for (half = 0; half < 2u; half++)
+		{
+			_mm_storeu_si128(&block[half],
+				sse4_permute(x[0], x[1], ctrl[half], upper[half]));
+		}
+	}
+}
+
+/** \brief SSE4.1 decoding kernel, one block per two registers.
+ *  \param tables Valid pointer to the decoding tables.
+ *  \param blocks Valid pointer to the blocks of memory.
+ *  \param blocks_num Number of blocks. */
+__attribute__((target("sse4.1")))
+static void sse4_decode(const struct simd_tables* tables,
+		uint8_t* blocks, size_t blocks_num)
+{
+	register size_t idx;
+	register size_t half;
+	__m128i mul_even[2];
+	__m128i mul_odd[2];
+	__m128i key[2];
+	__m128i noize[2];
+	__m128i ctrl[2];
+	__m128i upper[2];
+
+	for (half = 0; half < 2u; half++)
+	{
+		mul_even[half] = _mm_loadu_si128(
+				(const __m128i*)&tables->mul_even[half * 8u]);
+		mul_odd[half] = _mm_loadu_si128(
+				(const __m128i*)&tables->mul_odd[half * 8u]);
+		key[half] = _mm_loadu_si128(
+				(const __m128i*)&tables->key[half * 16u]);
+		noize[half] = _mm_loadu_si128(
+				(const __m128i*)&tables->noize[half * 16u]);
+		ctrl[half] = _mm_loadu_si128(
+				(const __m128i*)&tables->ctrl[half * 16u]);
+		upper[half] = _mm_loadu_si128(
+				(const __m128i*)&tables->upper[half * 16u]);
+	}
+
+	for (idx = 0; idx < blocks_num; idx++)
+	{
+		__m128i* block;
+		__m128i x[2];
+		__m128i y;
+
+		block = (__m128i*)&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES];
+		x[0] = _mm_loadu_si128(&block[0]);
+		x[1] = _mm_loadu_si128(&block[1]);
+
+		for (half = 0; half < 2u; half++)
+		{
+			y = sse4_permute(x[0], x[1], ctrl[half], upper[half]);
+			y = _mm_xor_si128(y, noize[half]);
+			y = _mm_sub_epi8(y, key[half]);
+			y = sse4_rol(y, mul_even[half], mul_odd[half]);
+			_mm_storeu_si128(&block[half], y);
+		}
+	}
+}
+
+/** \brief Transposes 8x8 matrix of 32-bit words held in 8 registers.
+ *  \param rows Valid pointer to the 8 rows, would be replaced by columns. */
+__attribute__((target("avx2")))
+static void avx2_transpose(__m256i* rows)
+{
+	register size_t idx;
+	__m256i pairs[8];
+	__m256i quads[8];
+
+	for (idx = 0; idx < 8u; idx += 2u)
+	{
+		pairs[idx] = _mm256_unpacklo_epi32(rows[idx], rows[idx + 1u]);
+		pairs[idx + 1u] = _mm256_unpackhi_epi32(rows[idx], rows[idx + 1u]);
+	}
+
+	for (idx = 0; idx < 8u; idx += 4u)
+	{
+		quads[idx] = _mm256_unpacklo_epi64(pairs[idx], pairs[idx + 2u]);
+		quads[idx + 1u] = _mm256_unpackhi_epi64(pairs[idx], pairs[idx + 2u]);
+		quads[idx + 2u] = _mm256_unpacklo_epi64(pairs[idx + 1u],
+				pairs[idx + 3u]);
+		quads[idx + 3u] = _mm256_unpackhi_epi64(pairs[idx + 1u],
+				pairs[idx + 3u]);
+	}
+
+	for (idx = 0; idx < 4u; idx++)
+	{
+		rows[idx] = _mm256_permute2x128_si256(quads[idx], quads[idx + 4u],
+				0x20);
+		rows[idx + 4u] = _mm256_permute2x128_si256(quads[idx],
+				quads[idx + 4u], 0x31);
+	}
+}
+
+/** \brief Generates the pseudo-random sequences of the noize stage for
+ *         ENCODEX_SIMD_BATCH_LANES keys at once. Each 32-bit lane runs its
+ *         own convolute and prnd, the low bytes of the states are packed into
+ *         words and transposed back to one sequence per register.
+ *  \param keys Valid pointer to the ENCODEX_SIMD_BATCH_LANES keys.
+ *  \param noize Valid pointer to ENCODEX_SIMD_BATCH_LANES registers, would be
+ *               overwritten with the sequences. */
+__attribute__((target("avx2")))
+static void avx2_batch_noize(const uint8_t* keys, __m256i* noize)
+{
+	register size_t idx;
+	register size_t step;
+	__m256i state;
+
+	for (idx = 0; idx < ENCODEX_SIMD_BATCH_LANES; idx++)
+	{
+		noize[idx] = _mm256_loadu_si256(
+				(const __m256i*)&keys[idx * ENCODEX_KEY_SIZE_BYTES]);
+	}
+
+	avx2_transpose(noize);
+	state = noize[0];
+
+	for (idx = 1; idx < ENCODEX_SIMD_BATCH_LANES; idx++)
+	{
+		state = _mm256_xor_si256(state, noize[idx]);
+	}
+
+	state = _mm256_blendv_epi8(state, _mm256_set1_epi32(0xc0ffee),
+			_mm256_cmpeq_epi32(state, _mm256_setzero_si256()));
+
+	for (idx = 0; idx < ENCODEX_SIMD_BATCH_LANES; idx++)
+	{
+		__m256i word;
+
+		word = _mm256_setzero_si256();
+
+		for (step = 0; step < sizeof(uint32_t); step++)
+		{
+			state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+			state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+			state = _mm256_xor_si256(state, _mm256_slli_epi32(state,  4));
+			word = _mm256_or_si256(_mm256_srli_epi32(word, 8),
+					_mm256_slli_epi32(state, 24));
+		}
+
+		noize[idx] = word;
+	}
+
+	avx2_transpose(noize);
+}
+
+/** \brief Rotates each byte of the block left for the amount taken from the
+ *         corresponding byte of the shift.
+ *  \param x The bytes to rotate.
+ *  \param shift The amounts, only 3 low bits of each byte are used.
+ *  \return The rotated bytes. */
+__attribute__((target("avx2")))
+static __m256i avx2_batch_rol(__m256i x, __m256i shift)
+{
+	__m256i mul;
+
+	mul = _mm256_shuffle_epi8(_mm256_setr_epi8(
+				1, 2, 4, 8, 16, 32, 64, (char)-128,
+				0, 0, 0, 0, 0, 0, 0, 0,
+				1, 2, 4, 8, 16, 32, 64, (char)-128,
+				0, 0, 0, 0, 0, 0, 0, 0),
+			_mm256_and_si256(shift, _mm256_set1_epi8(7)));
+
+	return avx2_rol(x,
+			_mm256_and_si256(mul, _mm256_set1_epi16(0x00ff)),
+			_mm256_srli_epi16(mul, 8));
+}
+
+/** \brief Permutates the block the way the shuffle stage does for the key.
+ *  \param x The block.
+ *  \param key Valid pointer to the key.
+ *  \param decode If not 0, applies the inverse permutation.
+ *  \return The permutated block. */
+__attribute__((target("avx2")))
+static __m256i avx2_batch_permute(__m256i x, const uint8_t* key, int decode)
+{
+	uint8_t perm[ENCODEX_BLOCK_SIZE_BYTES];
+	uint8_t inv_perm[ENCODEX_BLOCK_SIZE_BYTES];
+	uint8_t ctrl[ENCODEX_BLOCK_SIZE_BYTES];
+	uint8_t upper[ENCODEX_BLOCK_SIZE_BYTES];
+
+	encodex_schedule_perm(perm, inv_perm, key);
+	simd_permute_init(ctrl, upper, (decode != 0) ? inv_perm : perm);
+
+	return avx2_permute(x,
+			_mm256_loadu_si256((const __m256i*)ctrl),
+			_mm256_loadu_si256((const __m256i*)upper));
+}
+
+/** \brief AVX2 batch encoding kernel, ENCODEX_SIMD_BATCH_LANES blocks each
+ *         with its own key.
+ *  \param blocks Valid pointer to the blocks.
+ *  \param keys Valid pointer to the keys. */
+__attribute__((target("avx2")))
+static void avx2_batch_encode(uint8_t* blocks, const uint8_t* keys)
+{
+	register size_t idx;
+	__m256i noize[ENCODEX_SIMD_BATCH_LANES];
+
+	avx2_batch_noize(keys, noize);
+
+	for (idx = 0; idx < ENCODEX_SIMD_BATCH_LANES; idx++)
+	{
+		uint8_t* block;
+		const uint8_t* key_bytes;
+		__m256i key;
+		__m256i x;
+
+		block = &blocks[idx * ENCODEX_BLOCK_SIZE_BYTES];
+		key_bytes = &keys[idx * ENCODEX_KEY_SIZE_BYTES];
+		key = _mm256_loadu_si256((const __m256i*)key_bytes);
+		x = _mm256_loadu_si256((const __m256i*)block);
+		x = avx2_batch_rol(x, key);
+		x = _mm256_add_epi8(x, key);
+		x = _mm256_xor_si256(x, noize[idx]);
+		x = avx2_batch_permute(x, key_bytes, 0);
+		_mm256_storeu_si256((__m256i*)block, x);
+	}
+}
+
+/** \brief AVX2 batch decoding kernel, ENCODEX_SIMD_BATCH_LANES blocks each
+ *         with its own key.
+ *  \param blocks Valid pointer to the blocks.
+ *  \param keys Valid pointer to the keys. */
+__attribute__((target("avx2")))
+static void avx2_batch_decode(uint8_t* blocks, const uint8_t* keys)
+{
+	register size_t idx;
+	__m256i noize[ENCODEX_SIMD_BATCH_LANES];
+
+	avx2_batch_noize(keys, noize);
+
+	for (idx = 0; idx < ENCODEX_SIMD_BATCH_LANES; idx++)
+	{
+		uint8_t* block;
+		const uint8_t* key_bytes;
+		__m256i key;
+		__m256i x;
+
+		block = &blocks[idx * ENCODEX_BLOCK_SIZE_BYTES];
+		key_bytes = &keys[idx * ENCODEX_KEY_SIZE_BYTES];
+		key = _mm256_loadu_si256((const __m256i*)key_bytes);
+		x = _mm256_loadu_si256((const __m256i*)block);
+		x = avx2_batch_permute(x, key_bytes, 1);
+		x = _mm256_xor_si256(x, noize[idx]);
+		x = _mm256_sub_epi8(x, key);
+		x = avx2_batch_rol(x, _mm256_sub_epi8(_mm256_setzero_si256(), key));
+		_mm256_storeu_si256((__m256i*)block, x);
+	}
+}
+
+/** \brief The kernel chosen by the first encodex_simd_detect call, -1 before
+ *         it. Every thread would store the same value, the atomic access only
+ *         keeps the race well defined. */
+static int simd_detected = -1;
+
+#endif /* ENCODEX_SIMD_X86 */
+
+enum encodex_simd encodex_simd_detect(void)
+{
+	enum encodex_simd simd;
+#ifdef ENCODEX_SIMD_X86
+	int detected;
+#endif /* ENCODEX_SIMD_X86 */
+
+	simd = ENCODEX_SIMD_NONE;
+
+#ifdef ENCODEX_SIMD_X86
+	detected = __atomic_load_n(&simd_detected, __ATOMIC_RELAXED);
+
+	if (detected >= 0)
+	{
+		simd = (enum encodex_simd)detected;
+	}
+	else
+	{
+		if (__builtin_cpu_supports("avx2"))
+		{
+			simd = ENCODEX_SIMD_AVX2;
+		}
+		else if (__builtin_cpu_supports("sse4.1"))
+		{
+			simd = ENCODEX_SIMD_SSE4;
+		}
+		else
+		{
+		}
+
+		__atomic_store_n(&simd_detected, (int)simd, __ATOMIC_RELAXED);
+	}
+#endif /* ENCODEX_SIMD_X86 */
+
+	return simd;
+}
+
+const char* encodex_simd_name(enum encodex_simd simd)
+{
+	const char* name;
+
+	switch (simd)
+	{
+		case ENCODEX_SIMD_SSE4: name = "sse4.1"; break;
+		case ENCODEX_SIMD_AVX2: name = "avx2"; break;
+		default: name = "scalar"; break;
+	}
+
+	return name;
+}
+
+void encodex_simd_encode(enum encodex_simd simd,
+		const struct encodex_schedule* sched,
+		uint8_t* blocks, size_t blocks_num)
+{
+	register size_t idx;
+#ifdef ENCODEX_SIMD_X86
+	struct simd_tables tables;
+
+	if (simd != ENCODEX_SIMD_NONE)
+	{
+		simd_tables_init(&tables, sched, 0);
+	}
+
+	if (simd == ENCODEX_SIMD_AVX2)
+	{
+		avx2_encode(&tables, blocks, blocks_num);
+	}
+	else if (simd == ENCODEX_SIMD_SSE4)
+	{
+		sse4_encode(&tables, blocks, blocks_num);
+	}
+	else
+#else
+	(void)simd;
+#endif /* ENCODEX_SIMD_X86 */
+	{
+		for (idx = 0; idx < blocks_num; idx++)
+		{
+			encodex_schedule_encode(sched,
+					&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES]);
+		}
+	}
+}
+
+void encodex_simd_decode(enum encodex_simd simd,
+		const struct encodex_schedule* sched,
+		uint8_t* blocks, size_t blocks_num)
+{
+	register size_t idx;
+#ifdef ENCODEX_SIMD_X86
+	struct simd_tables tables;
+
+	if (simd != ENCODEX_SIMD_NONE)
+	{
+		simd_tables_init(&tables, sched, 1);
+	}
+
+	if (simd == ENCODEX_SIMD_AVX2)
+	{
+		avx2_decode(&tables, blocks, blocks_num);
+	}
+	else if (simd == ENCODEX_SIMD_SSE4)
+	{
+		sse4_decode(&tables, blocks, blocks_num);
+	}
+	else
+#else
+	(void)simd;
+#endif /* ENCODEX_SIMD_X86 */
+	{
+		for (idx = 0; idx < blocks_num; idx++)
+		{
+			encodex_schedule_decode(sched,
+					&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES]);
+		}
+	}
+}
+
+void encodex_simd_ecb(uint8_t* blocks, size_t blocks_num, const uint8_t* key)
+{
+	struct encodex_schedule sched;
+
+	encodex_schedule_init(&sched, key);
+	encodex_simd_encode(encodex_simd_detect(), &sched, blocks, blocks_num);
+}
+
+void decodex_simd_ecb(uint8_t* blocks, size_t blocks_num, const uint8_t* key)
+{
+	struct encodex_schedule sched;
+
+	encodex_schedule_init(&sched, key);
+	encodex_simd_decode(encodex_simd_detect(), &sched, blocks, blocks_num);
+}
+
+void encodex_simd_batch_encode(enum encodex_simd simd,
+		uint8_t* blocks, const uint8_t* keys, size_t num)
+{
+	register size_t idx;
+
+	idx = 0;
+
+#ifdef ENCODEX_SIMD_X86
+	if (simd == ENCODEX_SIMD_AVX2)
+	{
+		while ((num - idx) >= ENCODEX_SIMD_BATCH_LANES)
+		{
+			avx2_batch_encode(&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES],
+					&keys[idx * ENCODEX_KEY_SIZE_BYTES]);
+			idx += ENCODEX_SIMD_BATCH_LANES;
+		}
+	}
+#else
+	(void)simd;
+#endif /* ENCODEX_SIMD_X86 */
+
+	while (idx < num)
+	{
+		encodex(&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES],
+				&keys[idx * ENCODEX_KEY_SIZE_BYTES]);
+		idx++;
+	}
+}
+
+void encodex_simd_batch_decode(enum encodex_simd simd,
+		uint8_t* blocks, const uint8_t* keys, size_t num)
+{
+	register size_t idx;
+
+	idx = 0;
+
+#ifdef ENCODEX_SIMD_X86
+	if (simd == ENCODEX_SIMD_AVX2)
+	{
+		while ((num - idx) >= ENCODEX_SIMD_BATCH_LANES)
+		{
+			avx2_batch_decode(&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES],
+					&keys[idx * ENCODEX_KEY_SIZE_BYTES]);
+			idx += ENCODEX_SIMD_BATCH_LANES;
+		}
+	}
+#else
+	(void)simd;
+#endif /* ENCODEX_SIMD_X86 */
+
+	while (idx < num)
+	{
+		decodex(&blocks[idx * ENCODEX_BLOCK_SIZE_BYTES],
+				&keys[idx * ENCODEX_KEY_SIZE_BYTES]);
+		idx++;
+	}
+}
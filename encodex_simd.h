@@ -0,0 +1,153 @@
+/* Copyright © 2025 Artem Shapovalov <artem_shapovalov@aol.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of  this  software and associated documentation files  (the “Software”),  to
+ * deal  in the Software without restriction, including without limitation  the
+ * rights  to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell  copies of the Software, and to permit persons to whom the Software  is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The  above copyright notice and this permission notice shall be included  in
+ * all copies or substantial portions of the Software.
+ *
+ * THE  SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS  OR
+ * IMPLIED,  INCLUDING  BUT NOT LIMITED TO THE WARRANTIES  OF  MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL  THE
+ * AUTHORS  OR  COPYRIGHT  HOLDERS BE LIABLE FOR ANY CLAIM,  DAMAGES  OR  OTHER
+ * LIABILITY,  WHETHER  IN AN ACTION OF CONTRACT, TORT  OR  OTHERWISE,  ARISING
+ * FROM,  OUT  OF  OR  IN CONNECTION WITH THE SOFTWARE  OR  THE  USE  OR  OTHER
+ * DEALINGS IN THE SOFTWARE. */
+
+#ifndef ENCODEX_SIMD_H
+#define ENCODEX_SIMD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "encodex.h"
+
+/** \brief Block kernels available in this module. The x86 kernels are built
+ *         only with GCC compatible compilers for x86 targets, elsewhere only
+ *         the scalar one is available. */
+enum encodex_simd
+{
+	/** \brief Portable kernel of encodex.c. */
+	ENCODEX_SIMD_NONE = 0,
+
+	/** \brief Two 128-bit halves per block, needs SSE4.1. */
+	ENCODEX_SIMD_SSE4 = 1,
+
+	/** \brief One 256-bit register per block, needs AVX2. */
+	ENCODEX_SIMD_AVX2 = 2
+};
+
+/** \brief Number of messages the batch kernels process at once, one per
+ *         32-bit lane of a 256-bit register. */
+#define ENCODEX_SIMD_BATCH_LANES 8u
+
+/** \brief Detects the best kernel supported by the running CPU. The CPU is
+ *         probed on the first call only, the later calls return the cached
+ *         result.
+ *  \return The best available kernel. */
+enum encodex_simd encodex_simd_detect(void);
+
+/** \brief Returns the name of the kernel.
+ *  \param simd The kernel.
+ *  \return Static null-terminated string. */
+const char* encodex_simd_name(enum encodex_simd simd);
+
+/** \brief Encodes a multiple memory blocks independently with a given key
+ *         schedule and a requested kernel. The result is the same as the
+ *         encodex_ecb function gives.
+ *  \param simd The kernel to use. Should be supported by the running CPU,
+ *              see encodex_simd_detect.
+ *  \param sched Valid pointer to the initialized key schedule.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                encrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be proportional
+ *                to the ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of blocks stored in the memory provided by the
+ *                    blocks parameter. */
+void encodex_simd_encode(enum encodex_simd simd,
+		const struct encodex_schedule* sched,
+		uint8_t* blocks, size_t blocks_num);
+
+/** \brief Decodes a multiple memory blocks independently with a given key
+ *         schedule and a requested kernel. The result is the same as the
+ *         decodex_ecb function gives.
+ *  \param simd The kernel to use. Should be supported by the running CPU,
+ *              see encodex_simd_detect.
+ *  \param sched Valid pointer to the initialized key schedule.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                decrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be proportional
+ *                to the ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of blocks stored in the memory provided by the
+ *                    blocks parameter. */
+void encodex_simd_decode(enum encodex_simd simd,
+		const struct encodex_schedule* sched,
+		uint8_t* blocks, size_t blocks_num);
+
+/** \brief Same as encodex_ecb, but uses the best kernel of the running CPU.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                encrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be proportional
+ *                to the ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of blocks stored in the memory provided by the
+ *                    blocks parameter.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. This memory should be initialized
+ *             with the encryption key. */
+void encodex_simd_ecb(uint8_t* blocks, size_t blocks_num, const uint8_t* key);
+
+/** \brief Same as decodex_ecb, but uses the best kernel of the running CPU.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                decrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be proportional
+ *                to the ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param blocks_num Number of blocks stored in the memory provided by the
+ *                    blocks parameter.
+ *  \param key Valid pointer to the key. The size of the memory should be equal
+ *             to ENCODEX_KEY_SIZE_BYTES. This memory should be initialized
+ *             with the encryption key. */
+void decodex_simd_ecb(uint8_t* blocks, size_t blocks_num, const uint8_t* key);
+
+/** \brief Encodes a multiple memory blocks each with its own key, the block
+ *         with index i is encoded with the key with index i. The result is
+ *         the same as the encodex function gives for each pair. The AVX2
+ *         kernel handles ENCODEX_SIMD_BATCH_LANES pairs at once, including the
+ *         pseudo-random sequences, the rest of the pairs and other kernels
+ *         fall back to the encodex function.
+ *  \param simd The kernel to use. Should be supported by the running CPU,
+ *              see encodex_simd_detect.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                encrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be equal to
+ *                num * ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param keys Valid pointer to the keys. The size of the memory should be
+ *              equal to num * ENCODEX_KEY_SIZE_BYTES.
+ *  \param num Number of the block and key pairs. */
+void encodex_simd_batch_encode(enum encodex_simd simd,
+		uint8_t* blocks, const uint8_t* keys, size_t num);
+
+/** \brief Decodes a multiple memory blocks each with its own key, the block
+ *         with index i is decoded with the key with index i. The result is
+ *         the same as the decodex function gives for each pair.
+ *  \param simd The kernel to use. Should be supported by the running CPU,
+ *              see encodex_simd_detect.
+ *  \param blocks Valid pointer to the blocks of memory. This memory would be
+ *                decrypted and the new data would be written here instead of
+ *                the old one. The size of the memory should be equal to
+ *                num * ENCODEX_BLOCK_SIZE_BYTES.
+ *  \param keys Valid pointer to the keys. The size of the memory should be
+ *              equal to num * ENCODEX_KEY_SIZE_BYTES.
+ *  \param num Number of the block and key pairs. */
+void encodex_simd_batch_decode(enum encodex_simd simd,
+		uint8_t* blocks, const uint8_t* keys, size_t num);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* ENCODEX_SIMD_H */
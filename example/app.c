@@ -18,28 +18,121 @@
  * FROM,  OUT  OF  OR  IN CONNECTION WITH THE SOFTWARE  OR  THE  USE  OR  OTHER
  * DEALINGS IN THE SOFTWARE. */
 
+#if defined(__unix__) || defined(__APPLE__)
+#define APP_POSIX
+#define _POSIX_C_SOURCE 200112L
+#define _FILE_OFFSET_BITS 64
+#endif /* __unix__ || __APPLE__ */
+
+#if defined(APP_POSIX) && defined(__linux__) && !defined(APP_NO_URING)
+#define APP_URING
+#define _DEFAULT_SOURCE
+#endif /* APP_POSIX && __linux__ && !APP_NO_URING */
+
 #include "encodex.h"
+#include "encodex_simd.h"
+#include "encodex_sbox.h"
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef APP_POSIX
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif /* APP_POSIX */
+
+#ifdef APP_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif /* APP_URING */
+
+/* Size of the file buffers, should be proportional to the block size. */
+#define IO_BUFFER_SIZE (1024u * 1024u)
+
+/* Size of the length fields of the file formats. */
+#define FILE_HEADER_SIZE 8u
+
+/* The engines of the ECB blocks, chosen with --engine. */
+enum app_engine
+{
+	ENGINE_SIMD,
+	ENGINE_SCALAR,
+	ENGINE_SBOX
+};
+
 struct cli_result
 {
 	int error;
 	int help;
 	int encode;
 	int cbc;
+	int range;
+	int inplace;
+	int uring;
+	int stream;
+	int indexed;
+	enum app_engine engine;
+	unsigned int threads;
+	size_t offset;
+	size_t length;
 	const char* ifile;
 	const char* ofile;
 	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
 };
 
+static int parse_size(const char* str, size_t* value)
+{
+	unsigned long tmp;
+	char* end;
+	int res;
+
+	res = 0;
+	tmp = strtoul(str, &end, 0);
+
+	if ((end == str) || (*end != '\0') || (str[0] == '-'))
+	{
+		res = -1;
+	}
+	else
+	{
+		*value = (size_t)tmp;
+	}
+
+	return res;
+}
+
+static unsigned int default_threads(void)
+{
+	unsigned int res;
+
+	res = 0;
+
+#ifdef APP_POSIX
+	{
+		long cpus;
+
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		res = (cpus > 0) ? (unsigned int)cpus : 1u;
+	}
+#endif /* APP_POSIX */
+
+	return res;
+}
+
 static struct cli_result cli(int argc, char** argv)
 {
 	struct cli_result res;
 	register size_t idx;
 	const char* key;
+	const char* args[3];
+	size_t args_num;
+	size_t args_need;
 
 	uint8_t allow;
 
@@ -49,8 +142,19 @@ static struct cli_result cli(int argc, char** argv)
 	res.error = 0;
 	res.encode = 0;
 	res.cbc = 0;
+	res.range = 0;
+	res.inplace = 0;
+	res.uring = 0;
+	res.stream = 0;
+	res.indexed = 0;
+	res.engine = ENGINE_SIMD;
+	res.threads = default_threads();
+	res.offset = 0;
+	res.length = ~(size_t)0;
 	res.ifile = NULL;
 	res.ofile = NULL;
+	key = NULL;
+	args_num = 0;
 
 	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
 	{
@@ -69,12 +173,6 @@ static struct cli_result cli(int argc, char** argv)
 		allow = 0;
 	}
 
-	if ((allow == 1u) && (argc > 6))
-	{
-		res.error = 2;
-		allow = 0;
-	}
-
 	if (allow == 1u)
 	{
 		if (strcmp("encode", argv[1]) == 0)
@@ -92,32 +190,172 @@ static struct cli_result cli(int argc, char** argv)
 		}
 	}
 
-	if (allow == 1u)
+	for (idx = 2; (allow == 1u) && (idx < (size_t)argc); idx++)
 	{
-		if (strcmp("cbc", argv[2]) == 0)
+		if ((idx == 2u) && (strcmp("cbc", argv[idx]) == 0))
 		{
 			res.cbc = 1;
 		}
-
-		if (res.cbc != 0)
+		else if (strcmp("--offset", argv[idx]) == 0)
 		{
-			res.ifile = argv[3];
-			res.ofile = argv[4];
+			idx++;
+			if ((idx >= (size_t)argc)
+					|| (parse_size(argv[idx], &res.offset) != 0))
+			{
+				res.error = 6;
+				allow = 0;
+			}
+
+			res.range = 1;
 		}
-		else
+		else if (strcmp("--length", argv[idx]) == 0)
 		{
-			res.ifile = argv[2];
-			res.ofile = argv[3];
+			idx++;
+			if ((idx >= (size_t)argc)
+					|| (parse_size(argv[idx], &res.length) != 0))
+			{
+				res.error = 6;
+				allow = 0;
+			}
+
+			res.range = 1;
 		}
+		else if (strcmp("--threads", argv[idx]) == 0)
+		{
+			size_t threads;
 
-		if (res.cbc != 0)
+			idx++;
+			if ((idx >= (size_t)argc)
+					|| (parse_size(argv[idx], &threads) != 0)
+					|| (threads > 1024u))
+			{
+				res.error = 6;
+				allow = 0;
+			}
+			else
+			{
+				res.threads = (unsigned int)threads;
+			}
+		}
+		else if (strcmp("--inplace", argv[idx]) == 0)
+		{
+			res.inplace = 1;
+		}
+		else if (strcmp("--uring", argv[idx]) == 0)
+		{
+			res.uring = 1;
+		}
+		else if (strcmp("--stream", argv[idx]) == 0)
+		{
+			res.stream = 1;
+		}
+		else if (strcmp("--indexed", argv[idx]) == 0)
+		{
+			res.indexed = 1;
+		}
+		else if (strcmp("--engine", argv[idx]) == 0)
+		{
+			idx++;
+			if (idx >= (size_t)argc)
+			{
+				res.error = 6;
+				allow = 0;
+			}
+			else if (strcmp("simd", argv[idx]) == 0)
+			{
+				res.engine = ENGINE_SIMD;
+			}
+			else if (strcmp("scalar", argv[idx]) == 0)
+			{
+				res.engine = ENGINE_SCALAR;
+			}
+			else if (strcmp("sbox", argv[idx]) == 0)
+			{
+				res.engine = ENGINE_SBOX;
+			}
+			else
+			{
+				res.error = 6;
+				allow = 0;
+			}
+		}
+		else if (strncmp("--", argv[idx], 2) == 0)
+		{
+			res.error = 8;
+			allow = 0;
+		}
+		else if (args_num >= 3u)
 		{
-			key = argv[5];
+			res.error = 2;
+			allow = 0;
 		}
 		else
 		{
-			key = argv[4];
+			args[args_num] = argv[idx];
+			args_num++;
 		}
+	}
+
+	args_need = (res.inplace != 0) ? 2u : 3u;
+
+	if ((allow == 1u) && (args_num < args_need))
+	{
+		res.error = 1;
+		allow = 0;
+	}
+
+	if ((allow == 1u) && (args_num > args_need))
+	{
+		res.error = 2;
+		allow = 0;
+	}
+
+	if ((allow == 1u) && (res.range != 0)
+			&& ((res.encode != 0) || (res.inplace != 0)))
+	{
+		res.error = 7;
+		allow = 0;
+	}
+
+	if ((allow == 1u) && (res.indexed != 0) && ((res.stream != 0)
+				|| (res.inplace != 0) || (res.uring != 0)))
+	{
+		res.error = 7;
+		allow = 0;
+	}
+
+	if ((allow == 1u) && (res.inplace == 0) && (res.indexed == 0)
+			&& (strcmp("-", args[0]) == 0))
+	{
+		res.stream = 1;
+	}
+
+	if ((allow == 1u) && (res.stream != 0) && ((res.range != 0)
+				|| (res.inplace != 0) || (res.uring != 0)))
+	{
+		res.error = 7;
+		allow = 0;
+	}
+
+	if ((allow == 1u) && (res.uring != 0)
+			&& ((res.range != 0) || (res.inplace != 0)))
+	{
+		res.error = 7;
+		allow = 0;
+	}
+
+	/* The engines differ in ECB only, the chain is always scalar. */
+	if ((allow == 1u) && (res.cbc != 0) && (res.engine != ENGINE_SIMD))
+	{
+		res.error = 7;
+		allow = 0;
+	}
+
+	if (allow == 1u)
+	{
+		res.ifile = args[0];
+		res.ofile = args[args_need - 2u];
+		key = args[args_need - 1u];
 
 		if (strlen(key) != (ENCODEX_KEY_SIZE_BYTES * 2u))
 		{
@@ -189,11 +427,32 @@ static struct cli_result cli(int argc, char** argv)
 static void print_help(void)
 {
 	(void)printf("ENCODEX demo application\n");
-	(void)printf("Usage: encodex <command> [cbc] <ifile> <ofile> <key>\n");
+	(void)printf("Usage: encodex <command> [cbc] [options] "
+			"<ifile> <ofile> <key>\n");
 	(void)printf("	command	- encode/decode\n");
 	(void)printf("	cbc	- optional flag, use CBC algorithm\n");
-	(void)printf("	ifile	- input file path\n");
-	(void)printf("	ofile	- output file path\n");
+	(void)printf("	options:\n");
+	(void)printf("	--offset N	- decode only, skip N bytes of the output\n");
+	(void)printf("	--length M	- decode only, output at most M bytes\n");
+	(void)printf("	--threads N	- number of cipher threads, 0 disables "
+			"the pipeline\n");
+	(void)printf("	--inplace	- encrypt or decrypt the file in place, "
+			"ofile is omitted,\n"
+			"			  the result is readable only with "
+			"--inplace\n");
+	(void)printf("	--stream	- use the framed stream format, it "
+			"needs no seeking,\n"
+			"			  implied when ifile is -\n");
+	(void)printf("	--indexed	- use the chunked format with an index, "
+			"its chunks are\n"
+			"			  decoded in parallel and ranges are "
+			"read directly\n");
+	(void)printf("	--uring	- use io_uring for the file I/O where "
+			"available\n");
+	(void)printf("	--engine E	- ECB only, simd (default), scalar or "
+			"sbox\n");
+	(void)printf("	ifile	- input file path, - for stdin\n");
+	(void)printf("	ofile	- output file path, - for stdout\n");
 	(void)printf("	key	- hexadecimal key, 64 characters [0-9a-f]\n");
 }
 
@@ -206,291 +465,2052 @@ static void print_error(int error)
 		case 3: (void)printf("Unknown command\n"); break;
 		case 4: (void)printf("Wrong key size\n"); break;
 		case 5: (void)printf("Wrong key format\n"); break;
+		case 6: (void)printf("Wrong option value\n"); break;
+		case 7: (void)printf("Option is not supported for the command\n");
+			break;
+		case 8: (void)printf("Unknown option\n"); break;
 		default: (void)printf("Unknown error\n"); break;
 	}
 }
 
-static size_t get_file_size(FILE* f)
+/* The size of the file, with off_t on POSIX hosts, so the files over 2 GiB
+ * are measured where long is 32 bits wide. A size that doesn't fit the
+ * size_t is an error. */
+static int get_file_size(FILE* f, size_t* size)
 {
-	size_t current_pos;
-	size_t size;
-
+#ifdef APP_POSIX
+	off_t current_pos;
+	off_t end_pos;
+#else
+	long current_pos;
+	long end_pos;
+#endif /* APP_POSIX */
+	int res;
+
+	res = -1;
+#ifdef APP_POSIX
+	current_pos = ftello(f);
+	if ((current_pos >= 0) && (fseeko(f, 0, SEEK_END) == 0))
+	{
+		end_pos = ftello(f);
+		if ((fseeko(f, current_pos, SEEK_SET) == 0) && (end_pos >= 0)
+				&& ((off_t)(size_t)end_pos == end_pos))
+		{
+			*size = (size_t)end_pos;
+			res = 0;
+		}
+	}
+#else
 	current_pos = ftell(f);
-	(void)fseek(f, 0, SEEK_END);
-	size = ftell(f);
-	(void)fseek(f, current_pos, SEEK_SET);
+	if ((current_pos >= 0) && (fseek(f, 0, SEEK_END) == 0))
+	{
+		end_pos = ftell(f);
+		if ((fseek(f, current_pos, SEEK_SET) == 0) && (end_pos >= 0))
+		{
+			*size = (size_t)end_pos;
+			res = 0;
+		}
+	}
+#endif /* APP_POSIX */
 
-	return size;
+	return res;
 }
 
-static void write_block(const uint8_t* block, size_t offset, FILE* ofp)
+static void store_le64(uint8_t* dst, size_t value)
 {
 	size_t idx;
 
-	for (idx = offset; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	for (idx = 0; idx < 8u; idx++)
 	{
-		(void)fputc(block[idx], ofp);
+		dst[idx] = (uint8_t)(value & 0xffu);
+		value >>= 8;
 	}
 }
 
-static void encode_file(FILE* ifp, FILE* ofp, const uint8_t* key)
+static size_t load_le64(const uint8_t* src)
 {
 	size_t idx;
-	size_t file_size;
-	const uint8_t* file_size_bytes;
-	uint8_t block[ENCODEX_BLOCK_SIZE_BYTES];
-	size_t block_counter;
+	size_t value;
 
-	file_size = get_file_size(ifp);
-	file_size_bytes = (uint8_t*)&file_size;
-	for (idx = 0; idx < sizeof(size_t); idx++)
+	value = 0;
+	for (idx = 8u; idx > 0u; idx--)
 	{
-		(void)fputc(file_size_bytes[idx], ofp);
+		value = (value << 8) | src[idx - 1u];
 	}
 
-	block_counter = ENCODEX_BLOCK_SIZE_BYTES
-		- (file_size % ENCODEX_BLOCK_SIZE_BYTES);
+	return value;
+}
+
+/* The encrypted file starts with the plaintext length, 64-bit little-endian
+ * on every host. */
+static int write_header(FILE* f, size_t size)
+{
+	uint8_t header[FILE_HEADER_SIZE];
+
+	store_le64(header, size);
+
+	return (fwrite(header, 1, FILE_HEADER_SIZE, f) == FILE_HEADER_SIZE)
+		? 0 : -1;
+}
+
+static int read_header(FILE* f, size_t* size)
+{
+	uint8_t header[FILE_HEADER_SIZE];
+	int res;
 
-	for (idx = 0; idx < block_counter; idx++)
+	res = -1;
+	if (fread(header, 1, FILE_HEADER_SIZE, f) == FILE_HEADER_SIZE)
 	{
-		block[idx] = 0;
+		*size = load_le64(header);
+		res = 0;
 	}
 
-	if (block_counter >= ENCODEX_BLOCK_SIZE_BYTES)
+	return res;
+}
+
+/* The ECB engine of process_blocks. Both are set in main before anything
+ * is processed and only read afterwards, the cipher threads included. */
+static enum app_engine ecb_engine = ENGINE_SIMD;
+static struct encodex_sbox* ecb_sbox = NULL;
+
+static void process_blocks(struct encodex_ctx* ctx, uint8_t* blocks,
+		size_t blocks_num, int encode, int cbc)
+{
+	if ((cbc != 0) && (encode != 0))
 	{
-		block_counter = 0;
-		encodex(block, key);
-		write_block(block, 0, ofp);
+		encodex_ctx_encode_cbc(ctx, blocks, blocks_num);
 	}
-
-	for (idx = 0; idx < file_size; idx++)
+	else if (cbc != 0)
 	{
-		block[block_counter] = fgetc(ifp);
-		block_counter++;
-
-		if (block_counter >= ENCODEX_BLOCK_SIZE_BYTES)
-		{
-			block_counter = 0;
-			encodex(block, key);
-			write_block(block, 0, ofp);
-		}
+		encodex_ctx_decode_cbc(ctx, blocks, blocks_num);
+	}
+	else if ((ecb_engine == ENGINE_SBOX) && (encode != 0))
+	{
+		encodex_sbox_encode(ecb_sbox, blocks, blocks_num);
+	}
+	else if (ecb_engine == ENGINE_SBOX)
+	{
+		encodex_sbox_decode(ecb_sbox, blocks, blocks_num);
+	}
+	else if ((ecb_engine == ENGINE_SCALAR) && (encode != 0))
+	{
+		encodex_simd_encode(ENCODEX_SIMD_NONE, &ctx->schedule,
+				blocks, blocks_num);
+	}
+	else if (ecb_engine == ENGINE_SCALAR)
+	{
+		encodex_simd_decode(ENCODEX_SIMD_NONE, &ctx->schedule,
+				blocks, blocks_num);
+	}
+	else if (encode != 0)
+	{
+		encodex_simd_encode(encodex_simd_detect(), &ctx->schedule,
+				blocks, blocks_num);
+	}
+	else
+	{
+		encodex_simd_decode(encodex_simd_detect(), &ctx->schedule,
+				blocks, blocks_num);
 	}
-
 }
 
-static void decode_file(FILE* ifp, FILE* ofp, const uint8_t* key)
+struct file_job
+{
+	FILE* ifp;
+	FILE* ofp;
+	struct encodex_ctx ctx;
+	int encode;
+	int cbc;
+	size_t size;
+	size_t pad;
+	size_t skip;
+	size_t left;
+};
+
+/* Reads the next chunk of blocks. When encoding the first chunk starts with
+ * the padding and the last one is completed with zeros, when decoding an
+ * incomplete trailing block is dropped. */
+static size_t job_read(struct file_job* job, uint8_t* chunk, int* eof)
 {
 	size_t idx;
-	size_t file_size;
-	size_t skip_bytes;
-	uint8_t* file_size_bytes;
-	size_t ifile_size;
-	uint8_t block[ENCODEX_BLOCK_SIZE_BYTES];
-	size_t block_counter;
+	size_t fill;
+	size_t got;
+	size_t size;
 
-	file_size_bytes = (uint8_t*)&file_size;
-	for (idx = 0; idx < sizeof(size_t); idx++)
+	fill = job->pad;
+	for (idx = 0; idx < fill; idx++)
 	{
-		file_size_bytes[idx] = fgetc(ifp);
+		chunk[idx] = 0;
 	}
 
-	skip_bytes = ENCODEX_BLOCK_SIZE_BYTES
-		- (file_size % ENCODEX_BLOCK_SIZE_BYTES);
+	got = fread(&chunk[fill], 1, IO_BUFFER_SIZE - fill, job->ifp);
+	*eof = (got < (IO_BUFFER_SIZE - fill)) ? 1 : 0;
+	fill += got;
+	job->pad = 0;
 
-	block_counter = 0;
-	ifile_size = get_file_size(ifp);
-	for (idx = sizeof(size_t); idx < ifile_size; idx++)
+	if (job->encode != 0)
 	{
-		block[block_counter] = fgetc(ifp);
-		block_counter++;
-
-		if (block_counter >= ENCODEX_BLOCK_SIZE_BYTES)
+		size = ((fill + ENCODEX_BLOCK_SIZE_BYTES - 1u)
+				/ ENCODEX_BLOCK_SIZE_BYTES) * ENCODEX_BLOCK_SIZE_BYTES;
+		for (idx = fill; idx < size; idx++)
 		{
-			block_counter = 0;
-
-			decodex(block, key);
-			write_block(block, skip_bytes, ofp);
-			skip_bytes = 0;
+			chunk[idx] = 0;
 		}
 	}
+	else
+	{
+		size = (fill / ENCODEX_BLOCK_SIZE_BYTES) * ENCODEX_BLOCK_SIZE_BYTES;
+	}
+
+	return size;
 }
 
-static void encode_file_cbc(FILE* ifp, FILE* ofp, uint8_t* key)
+/* Writes the processed chunk. When decoding the padding in front of the
+ * data and anything after the stored length is dropped. */
+static int job_write(struct file_job* job, const uint8_t* chunk, size_t size)
 {
-	size_t idx;
-	uint32_t seed;
-	size_t file_size;
-	const uint8_t* file_size_bytes;
-	uint8_t block[ENCODEX_BLOCK_SIZE_BYTES];
-	size_t block_counter;
-	
-	encodex_cbc_stream_init(key, &seed);
-
-	file_size = get_file_size(ifp);
-	file_size_bytes = (uint8_t*)&file_size;
-	for (idx = 0; idx < sizeof(size_t); idx++)
-	{
-		(void)fputc(file_size_bytes[idx], ofp);
-	}
+	size_t from;
+	size_t out;
+	int res;
 
-	block_counter = ENCODEX_BLOCK_SIZE_BYTES
-		- (file_size % ENCODEX_BLOCK_SIZE_BYTES);
+	res = 0;
+	from = 0;
+	out = size;
 
-	for (idx = 0; idx < block_counter; idx++)
+	if (job->encode == 0)
 	{
-		block[idx] = 0;
+		from = (job->skip < size) ? job->skip : size;
+		out = size - from;
+		out = (out < job->left) ? out : job->left;
+		job->skip -= from;
+		job->left -= out;
 	}
 
-	if (block_counter >= ENCODEX_BLOCK_SIZE_BYTES)
+	if (fwrite(&chunk[from], 1, out, job->ofp) != out)
 	{
-		block_counter = 0;
-		encodex_cbc_stream(block, key, &seed);
-		write_block(block, 0, ofp);
+		res = -1;
 	}
 
-	for (idx = 0; idx < file_size; idx++)
-	{
-		block[block_counter] = fgetc(ifp);
-		block_counter++;
+	return res;
+}
 
-		if (block_counter >= ENCODEX_BLOCK_SIZE_BYTES)
-		{
-			block_counter = 0;
-			encodex_cbc_stream(block, key, &seed);
-			write_block(block, 0, ofp);
-		}
-	}
+static int job_done(const struct file_job* job)
+{
+	return ((job->encode == 0) && (job->left == 0u)) ? 1 : 0;
 }
 
-static void decode_file_cbc(FILE* ifp, FILE* ofp, uint8_t* key)
+/* The input ended before the length stored in the header was decoded. */
+static int job_truncated(const struct file_job* job)
 {
-	size_t idx;
-	size_t file_size;
-	size_t skip_bytes;
-	uint8_t* file_size_bytes;
-	size_t ifile_size;
-	uint8_t block[ENCODEX_BLOCK_SIZE_BYTES];
-	size_t block_counter;
-	uint32_t seed;
+	return ((job->encode == 0) && (job->left != 0u)) ? 1 : 0;
+}
 
-	encodex_cbc_stream_init(key, &seed);
+static int job_run_serial(struct file_job* job)
+{
+	uint8_t* chunk;
+	size_t size;
+	int eof;
+	int res;
 
-	file_size_bytes = (uint8_t*)&file_size;
-	for (idx = 0; idx < sizeof(size_t); idx++)
+	res = 0;
+	chunk = (uint8_t*)malloc(IO_BUFFER_SIZE);
+	if (chunk == NULL)
 	{
-		file_size_bytes[idx] = fgetc(ifp);
+		res = -1;
 	}
 
-	skip_bytes = ENCODEX_BLOCK_SIZE_BYTES
-		- (file_size % ENCODEX_BLOCK_SIZE_BYTES);
-
-	block_counter = 0;
-	ifile_size = get_file_size(ifp);
-	for (idx = sizeof(size_t); idx < ifile_size; idx++)
+	eof = (res == 0) ? 0 : 1;
+	while ((eof == 0) && (job_done(job) == 0))
 	{
-		block[block_counter] = fgetc(ifp);
-		block_counter++;
+		size = job_read(job, chunk, &eof);
+		process_blocks(&job->ctx, chunk, size / ENCODEX_BLOCK_SIZE_BYTES,
+				job->encode, job->cbc);
 
-		if (block_counter >= ENCODEX_BLOCK_SIZE_BYTES)
+		if (job_write(job, chunk, size) != 0)
 		{
-			block_counter = 0;
-
-			decodex_cbc_stream(block, key, &seed);
-			write_block(block, skip_bytes, ofp);
-			skip_bytes = 0;
+			res = -1;
+			eof = 1;
 		}
 	}
+
+	if ((res == 0) && (job_truncated(job) != 0))
+	{
+		res = -1;
+	}
+
+	free(chunk);
+
+	return res;
 }
 
-int main(int argc, char** argv)
-{
-	struct cli_result cr;
-	FILE* ifp;
-	FILE* ofp;
+#ifdef APP_POSIX
 
-	int close_ifp;
-	int close_ofp;
+/* Chunks in flight per worker thread. */
+#define PIPELINE_DEPTH 2u
 
-	uint8_t allow;
-	int retval;
+enum chunk_state
+{
+	CHUNK_FREE,
+	CHUNK_READ,
+	CHUNK_DONE
+};
 
-	close_ifp = 0;
-	close_ofp = 0;
+struct chunk
+{
+	uint8_t* data;
+	size_t size;
+	enum chunk_state state;
+};
 
-	allow = 1u;
-	retval = 0;
-	
-	cr = cli(argc, argv);
+/* The reader, the workers and the writer pass the chunks around a ring:
+ * the chunk number seq lives in the slot seq % chunks_num. The reader
+ * publishes chunks in order, the workers take them in order but may finish
+ * in any order, and the writer takes them back in order, so the output
+ * order is kept. The eof flag belongs to the reader, the stop flag only goes
+ * from 0 to 1 when the writer needs no more chunks or something failed, then
+ * every thread leaves at its next wait. */
+struct pipeline
+{
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct file_job* job;
+	struct chunk* chunks;
+	size_t chunks_num;
+	size_t read_seq;
+	size_t work_seq;
+	size_t write_seq;
+	int eof;
+	int stop;
+	int error;
+};
 
-	if (cr.error != 0)
-	{
-		print_error(cr.error);
-		print_help();
-		allow = 0;
-		retval = -1;
-	}
+static void* pipeline_reader(void* arg)
+{
+	struct pipeline* pl;
+	struct chunk* chunk;
+	int eof;
 
-	if (allow == 1u)
+	pl = (struct pipeline*)arg;
+	eof = 0;
+
+	while (eof == 0)
 	{
-		if (cr.help != 0)
+		(void)pthread_mutex_lock(&pl->lock);
+		chunk = &pl->chunks[pl->read_seq % pl->chunks_num];
+		while ((chunk->state != CHUNK_FREE) && (pl->stop == 0))
 		{
-			print_help();
-			allow = 0;
-			retval = 0;
+			(void)pthread_cond_wait(&pl->cond, &pl->lock);
 		}
-	}
+		eof = pl->stop;
+		(void)pthread_mutex_unlock(&pl->lock);
 
-	if (allow == 1u)
-	{
-		ifp = fopen(cr.ifile, "rb");
-		if (ifp == NULL)
+		if (eof == 0)
 		{
-			(void)printf("Can't open %s\n", cr.ifile);
-			allow = 0;
-			retval = -1;
+			chunk->size = job_read(pl->job, chunk->data, &eof);
 		}
-		else
+
+		(void)pthread_mutex_lock(&pl->lock);
+		if ((pl->stop == 0) && (chunk->size > 0u))
 		{
-			close_ifp = 1;
+			chunk->state = CHUNK_READ;
+			pl->read_seq++;
 		}
+		eof = (pl->stop != 0) ? 1 : eof;
+		pl->eof = eof;
+		(void)pthread_cond_broadcast(&pl->cond);
+		(void)pthread_mutex_unlock(&pl->lock);
 	}
 
-	if (allow == 1u)
+	return NULL;
+}
+
+static void* pipeline_worker(void* arg)
+{
+	struct pipeline* pl;
+	struct chunk* chunk;
+	struct encodex_ctx ctx;
+	size_t seq;
+	int stop;
+
+	pl = (struct pipeline*)arg;
+	stop = 0;
+
+	while (stop == 0)
 	{
-		ofp = fopen(cr.ofile, "wb");
-		if (ofp == NULL)
+		(void)pthread_mutex_lock(&pl->lock);
+		while ((pl->work_seq >= pl->read_seq) && (pl->eof == 0)
+				&& (pl->stop == 0))
 		{
-			(void)printf("Can't open %s\n", cr.ofile);
-			close_ifp = 1;
-			allow = 0;
-			retval = -1;
+			(void)pthread_cond_wait(&pl->cond, &pl->lock);
 		}
-		else
+
+		seq = pl->work_seq;
+		chunk = &pl->chunks[seq % pl->chunks_num];
+		stop = ((seq >= pl->read_seq) || (pl->stop != 0)) ? 1 : 0;
+		if (stop == 0)
+		{
+			pl->work_seq++;
+		}
+		(void)pthread_mutex_unlock(&pl->lock);
+
+		if (stop == 0)
+		{
+			ctx = pl->job->ctx;
+			if (pl->job->cbc != 0)
+			{
+				encodex_cbc_seek(&ctx,
+					seq * (IO_BUFFER_SIZE / ENCODEX_BLOCK_SIZE_BYTES));
+			}
+
+			process_blocks(&ctx, chunk->data,
+					chunk->size / ENCODEX_BLOCK_SIZE_BYTES,
+					pl->job->encode, pl->job->cbc);
+
+			(void)pthread_mutex_lock(&pl->lock);
+			chunk->state = CHUNK_DONE;
+			(void)pthread_cond_broadcast(&pl->cond);
+			(void)pthread_mutex_unlock(&pl->lock);
+		}
+	}
+
+	return NULL;
+}
+
+static void pipeline_writer(struct pipeline* pl)
+{
+	struct chunk* chunk;
+	int stop;
+
+	stop = 0;
+
+	while (stop == 0)
+	{
+		(void)pthread_mutex_lock(&pl->lock);
+		chunk = &pl->chunks[pl->write_seq % pl->chunks_num];
+		while ((((pl->write_seq < pl->read_seq) && (chunk->state != CHUNK_DONE))
+				|| ((pl->write_seq >= pl->read_seq) && (pl->eof == 0)))
+				&& (pl->stop == 0))
+		{
+			(void)pthread_cond_wait(&pl->cond, &pl->lock);
+		}
+		stop = ((pl->write_seq >= pl->read_seq) || (pl->stop != 0)) ? 1 : 0;
+		(void)pthread_mutex_unlock(&pl->lock);
+
+		if (stop == 0)
+		{
+			stop = job_write(pl->job, chunk->data, chunk->size);
+
+			(void)pthread_mutex_lock(&pl->lock);
+			chunk->state = CHUNK_FREE;
+			pl->write_seq++;
+			if ((stop != 0) || (job_done(pl->job) != 0))
+			{
+				pl->error = (stop != 0) ? 1 : pl->error;
+				pl->stop = 1;
+				stop = 1;
+			}
+			(void)pthread_cond_broadcast(&pl->cond);
+			(void)pthread_mutex_unlock(&pl->lock);
+		}
+	}
+}
+
+static int job_run_pipeline(struct file_job* job, unsigned int workers)
+{
+	struct pipeline pl;
+	pthread_t reader;
+	pthread_t* threads;
+	size_t started;
+	size_t idx;
+	int reader_started;
+	int res;
+
+	res = 0;
+	started = 0;
+	reader_started = 0;
+
+	pl.job = job;
+	pl.chunks_num = (workers * PIPELINE_DEPTH) + 2u;
+	pl.read_seq = 0;
+	pl.work_seq = 0;
+	pl.write_seq = 0;
+	pl.eof = 0;
+	pl.stop = 0;
+	pl.error = 0;
+	(void)pthread_mutex_init(&pl.lock, NULL);
+	(void)pthread_cond_init(&pl.cond, NULL);
+
+	threads = (pthread_t*)malloc(workers * sizeof(*threads));
+	pl.chunks = (struct chunk*)calloc(pl.chunks_num, sizeof(*pl.chunks));
+	if ((threads == NULL) || (pl.chunks == NULL))
+	{
+		res = -1;
+	}
+
+	for (idx = 0; (res == 0) && (idx < pl.chunks_num); idx++)
+	{
+		pl.chunks[idx].data = (uint8_t*)malloc(IO_BUFFER_SIZE);
+		pl.chunks[idx].state = CHUNK_FREE;
+		if (pl.chunks[idx].data == NULL)
+		{
+			res = -1;
+		}
+	}
+
+	if (res == 0)
+	{
+		reader_started = (pthread_create(&reader, NULL,
+				pipeline_reader, &pl) == 0) ? 1 : 0;
+		res = (reader_started != 0) ? 0 : -1;
+	}
+
+	for (idx = 0; (res == 0) && (idx < workers); idx++)
+	{
+		if (pthread_create(&threads[idx], NULL, pipeline_worker, &pl) != 0)
+		{
+			res = -1;
+		}
+		else
+		{
+			started++;
+		}
+	}
+
+	if (res == 0)
+	{
+		pipeline_writer(&pl);
+		res = ((pl.error != 0) || (job_truncated(job) != 0)) ? -1 : 0;
+	}
+	else
+	{
+		(void)pthread_mutex_lock(&pl.lock);
+		pl.error = 1;
+		pl.stop = 1;
+		(void)pthread_cond_broadcast(&pl.cond);
+		(void)pthread_mutex_unlock(&pl.lock);
+	}
+
+	if (reader_started != 0)
+	{
+		(void)pthread_join(reader, NULL);
+	}
+
+	for (idx = 0; idx < started; idx++)
+	{
+		(void)pthread_join(threads[idx], NULL);
+	}
+
+	for (idx = 0; (pl.chunks != NULL) && (idx < pl.chunks_num); idx++)
+	{
+		free(pl.chunks[idx].data);
+	}
+
+	free(pl.chunks);
+	free(threads);
+	(void)pthread_cond_destroy(&pl.cond);
+	(void)pthread_mutex_destroy(&pl.lock);
+
+	return res;
+}
+
+#endif /* APP_POSIX */
+
+#ifdef APP_URING
+
+/* Chunks in flight of the io_uring backend. */
+#define URING_DEPTH 8u
+
+enum uring_state
+{
+	URING_FREE,
+	URING_READING,
+	URING_READ,
+	URING_WRITING
+};
+
+struct uring_slot
+{
+	uint8_t* data;
+	size_t seq;
+	size_t from;
+	size_t done;
+	size_t size;
+	off_t offset;
+	enum uring_state state;
+};
+
+struct uring
+{
+	int fd;
+	int fixed;
+	unsigned int queued;
+	unsigned int inflight;
+	void* sq_ptr;
+	size_t sq_size;
+	void* cq_ptr;
+	size_t cq_size;
+	struct io_uring_sqe* sqes;
+	size_t sqes_size;
+	unsigned int* sq_tail;
+	unsigned int* sq_mask;
+	unsigned int* sq_array;
+	unsigned int* cq_head;
+	unsigned int* cq_tail;
+	unsigned int* cq_mask;
+	struct io_uring_cqe* cqes;
+};
+
+/* There is no liburing dependency, the rings are driven with the raw system
+ * calls of the kernel interface. */
+static int uring_init(struct uring* ring, unsigned int entries)
+{
+	struct io_uring_params params;
+	uint8_t* sq;
+	uint8_t* cq;
+	int res;
+
+	res = 0;
+	(void)memset(ring, 0, sizeof(*ring));
+	(void)memset(&params, 0, sizeof(params));
+
+	ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+	if (ring->fd < 0)
+	{
+		res = -1;
+	}
+
+	if (res == 0)
+	{
+		ring->sq_size = params.sq_off.array
+			+ (params.sq_entries * sizeof(unsigned int));
+		ring->cq_size = params.cq_off.cqes
+			+ (params.cq_entries * sizeof(struct io_uring_cqe));
+		ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+		ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+		ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+		ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size,
+				PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd,
+				IORING_OFF_SQES);
+
+		if ((ring->sq_ptr == MAP_FAILED) || (ring->cq_ptr == MAP_FAILED)
+				|| ((void*)ring->sqes == MAP_FAILED))
+		{
+			res = -1;
+		}
+	}
+
+	if (res == 0)
+	{
+		sq = (uint8_t*)ring->sq_ptr;
+		cq = (uint8_t*)ring->cq_ptr;
+		ring->sq_tail = (unsigned int*)&sq[params.sq_off.tail];
+		ring->sq_mask = (unsigned int*)&sq[params.sq_off.ring_mask];
+		ring->sq_array = (unsigned int*)&sq[params.sq_off.array];
+		ring->cq_head = (unsigned int*)&cq[params.cq_off.head];
+		ring->cq_tail = (unsigned int*)&cq[params.cq_off.tail];
+		ring->cq_mask = (unsigned int*)&cq[params.cq_off.ring_mask];
+		ring->cqes = (struct io_uring_cqe*)&cq[params.cq_off.cqes];
+	}
+
+	return res;
+}
+
+static void uring_free(struct uring* ring)
+{
+	if ((ring->sq_ptr != NULL) && (ring->sq_ptr != MAP_FAILED))
+	{
+		(void)munmap(ring->sq_ptr, ring->sq_size);
+	}
+
+	if ((ring->cq_ptr != NULL) && (ring->cq_ptr != MAP_FAILED))
+	{
+		(void)munmap(ring->cq_ptr, ring->cq_size);
+	}
+
+	if ((ring->sqes != NULL) && ((void*)ring->sqes != MAP_FAILED))
+	{
+		(void)munmap(ring->sqes, ring->sqes_size);
+	}
+
+	if (ring->fd >= 0)
+	{
+		(void)close(ring->fd);
+	}
+}
+
+/* The slots are registered as fixed buffers when the kernel allows it, so
+ * their pages are not pinned again for every request. */
+static void uring_register(struct uring* ring, struct uring_slot* slots)
+{
+	struct iovec iov[URING_DEPTH];
+	size_t idx;
+
+	for (idx = 0; idx < URING_DEPTH; idx++)
+	{
+		iov[idx].iov_base = slots[idx].data;
+		iov[idx].iov_len = IO_BUFFER_SIZE;
+	}
+
+	ring->fixed = (syscall(__NR_io_uring_register, ring->fd,
+			IORING_REGISTER_BUFFERS, iov, URING_DEPTH) == 0) ? 1 : 0;
+}
+
+static void uring_queue(struct uring* ring, struct uring_slot* slot,
+		size_t slot_idx, int fd, int write)
+{
+	struct io_uring_sqe* sqe;
+	unsigned int tail;
+	unsigned int idx;
+
+	tail = *ring->sq_tail;
+	idx = tail & *ring->sq_mask;
+	sqe = &ring->sqes[idx];
+	(void)memset(sqe, 0, sizeof(*sqe));
+
+	if (ring->fixed != 0)
+	{
+		sqe->opcode = (write != 0) ? IORING_OP_WRITE_FIXED
+			: IORING_OP_READ_FIXED;
+		sqe->buf_index = (uint16_t)slot_idx;
+	}
+	else
+	{
+		sqe->opcode = (write != 0) ? IORING_OP_WRITE : IORING_OP_READ;
+	}
+
+	sqe->fd = fd;
+	sqe->off = (uint64_t)(slot->offset + (off_t)slot->done);
+	sqe->addr = (uint64_t)(uintptr_t)&slot->data[slot->from + slot->done];
+	sqe->len = (uint32_t)(slot->size - slot->done);
+	sqe->user_data = slot_idx;
+
+	ring->sq_array[idx] = idx;
+	__atomic_store_n(ring->sq_tail, tail + 1u, __ATOMIC_RELEASE);
+	ring->queued++;
+	ring->inflight++;
+}
+
+static int uring_submit(struct uring* ring, unsigned int wait)
+{
+	long done;
+	int res;
+
+	res = 0;
+	done = syscall(__NR_io_uring_enter, ring->fd, ring->queued, wait,
+			(wait > 0u) ? IORING_ENTER_GETEVENTS : 0u, NULL, 0);
+
+	if (done < 0)
+	{
+		res = -1;
+	}
+	else
+	{
+		ring->queued -= (unsigned int)done;
+	}
+
+	return res;
+}
+
+/* Sets the read of the chunk seq up. The stream of the blocks is the padding
+ * and the data when encoding and the whole ciphertext when decoding. */
+static void uring_plan_read(const struct file_job* job, struct uring_slot* slot,
+		size_t seq, size_t stream_size, off_t base)
+{
+	size_t idx;
+	size_t start;
+	size_t end;
+
+	start = seq * IO_BUFFER_SIZE;
+	end = start + IO_BUFFER_SIZE;
+	end = (end < stream_size) ? end : stream_size;
+
+	slot->seq = seq;
+	slot->from = 0;
+	slot->done = 0;
+	slot->size = end - start;
+	slot->offset = base + (off_t)start;
+
+	if ((job->encode != 0) && (seq == 0u))
+	{
+		for (idx = 0; idx < job->pad; idx++)
+		{
+			slot->data[idx] = 0;
+		}
+
+		slot->from = job->pad;
+		slot->size -= job->pad;
+	}
+	else if (job->encode != 0)
+	{
+		slot->offset -= (off_t)job->pad;
+	}
+}
+
+/* Sets the write of the ciphered chunk up, the size of the chunk is rounded
+ * up to the whole blocks. */
+static void uring_plan_write(const struct file_job* job,
+		struct uring_slot* slot, size_t size, off_t base)
+{
+	size_t start;
+	size_t from;
+	size_t out;
+
+	start = slot->seq * IO_BUFFER_SIZE;
+	from = 0;
+	out = size;
+
+	if (job->encode == 0)
+	{
+		from = (job->skip > start) ? (job->skip - start) : 0u;
+		from = (from < size) ? from : size;
+		out = size - from;
+		start = start + from - job->skip;
+		out = ((job->size - start) < out) ? (job->size - start) : out;
+	}
+
+	slot->from = from;
+	slot->done = 0;
+	slot->size = out;
+	slot->offset = base + (off_t)start;
+}
+
+/* Reads ahead of the cipher and writes behind it with a single thread: up to
+ * URING_DEPTH chunks are in flight and the cipher takes them in order. */
+static int job_run_uring(struct file_job* job)
+{
+	struct uring ring;
+	struct uring_slot slots[URING_DEPTH];
+	struct uring_slot* slot;
+	struct io_uring_cqe* cqe;
+	unsigned int head;
+	size_t stream_size;
+	size_t chunks_num;
+	size_t read_seq;
+	size_t cipher_seq;
+	size_t write_num;
+	size_t size;
+	size_t idx;
+	off_t in_base;
+	off_t out_base;
+	int in_fd;
+	int out_fd;
+	int res;
+
+	res = 0;
+	(void)memset(slots, 0, sizeof(slots));
+
+	if (uring_init(&ring, URING_DEPTH * 2u) != 0)
+	{
+		/* Not available, the caller falls back to the stdio backend. */
+		res = -2;
+	}
+
+	for (idx = 0; (res == 0) && (idx < URING_DEPTH); idx++)
+	{
+		slots[idx].data = (uint8_t*)malloc(IO_BUFFER_SIZE);
+		slots[idx].state = URING_FREE;
+		if (slots[idx].data == NULL)
+		{
+			res = -2;
+		}
+	}
+
+	if (res == 0)
+	{
+		uring_register(&ring, slots);
+		res = (fflush(job->ofp) == 0) ? 0 : -1;
+	}
+
+	stream_size = (job->encode != 0) ? (job->pad + job->size)
+		: (job->skip + job->size);
+	chunks_num = (stream_size + IO_BUFFER_SIZE - 1u) / IO_BUFFER_SIZE;
+	in_base = (job->encode != 0) ? 0 : (off_t)FILE_HEADER_SIZE;
+	out_base = (job->encode != 0) ? (off_t)FILE_HEADER_SIZE : 0;
+	in_fd = fileno(job->ifp);
+	out_fd = fileno(job->ofp);
+	read_seq = 0;
+	cipher_seq = 0;
+	write_num = 0;
+
+	while ((res == 0) && (write_num < chunks_num))
+	{
+		slot = &slots[read_seq % URING_DEPTH];
+		while ((read_seq < chunks_num) && (slot->state == URING_FREE))
+		{
+			uring_plan_read(job, slot, read_seq, stream_size, in_base);
+			slot->state = URING_READ;
+			if (slot->size > 0u)
+			{
+				slot->state = URING_READING;
+				uring_queue(&ring, slot, read_seq % URING_DEPTH, in_fd, 0);
+			}
+
+			read_seq++;
+			slot = &slots[read_seq % URING_DEPTH];
+		}
+
+		slot = &slots[cipher_seq % URING_DEPTH];
+		if ((cipher_seq < read_seq) && (slot->state == URING_READ))
+		{
+			size = slot->from + slot->size;
+			for (idx = size; (idx % ENCODEX_BLOCK_SIZE_BYTES) != 0u; idx++)
+			{
+				slot->data[idx] = 0;
+			}
+
+			size = idx;
+			process_blocks(&job->ctx, slot->data,
+					size / ENCODEX_BLOCK_SIZE_BYTES, job->encode, job->cbc);
+
+			uring_plan_write(job, slot, size, out_base);
+			slot->state = URING_WRITING;
+			if (slot->size == 0u)
+			{
+				slot->state = URING_FREE;
+				write_num++;
+			}
+			else
+			{
+				uring_queue(&ring, slot, cipher_seq % URING_DEPTH, out_fd, 1);
+			}
+
+			cipher_seq++;
+		}
+		else if (uring_submit(&ring, 1u) != 0)
+		{
+			res = -1;
+		}
+		else
+		{
+			head = *ring.cq_head;
+			while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE))
+			{
+				cqe = &ring.cqes[head & *ring.cq_mask];
+				slot = &slots[cqe->user_data];
+				ring.inflight--;
+				head++;
+
+				if (cqe->res <= 0)
+				{
+					/* An error or an unexpected end of the file. */
+					res = -1;
+					slot->done = slot->size;
+				}
+				else
+				{
+					slot->done += (size_t)cqe->res;
+				}
+
+				if (slot->done < slot->size)
+				{
+					uring_queue(&ring, slot, (size_t)(slot - slots),
+							(slot->state == URING_WRITING) ? out_fd : in_fd,
+							(slot->state == URING_WRITING) ? 1 : 0);
+				}
+				else if (slot->state == URING_READING)
+				{
+					slot->state = URING_READ;
+				}
+				else
+				{
+					slot->state = URING_FREE;
+					write_num++;
+				}
+			}
+
+			__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+		}
+	}
+
+	/* The requests still in flight are drained before the buffers go away. */
+	while ((res != -2) && (ring.inflight > 0u)
+			&& (uring_submit(&ring, 1u) == 0))
+	{
+		head = *ring.cq_head;
+		while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE))
+		{
+			ring.inflight--;
+			head++;
+		}
+
+		__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	for (idx = 0; idx < URING_DEPTH; idx++)
+	{
+		free(slots[idx].data);
+	}
+
+	uring_free(&ring);
+
+	return res;
+}
+
+#endif /* APP_URING */
+
+static int job_run(struct file_job* job, unsigned int threads, int uring)
+{
+	int res;
+
+	res = -2;
+
+#ifdef APP_URING
+	if (uring != 0)
+	{
+		res = job_run_uring(job);
+	}
+#else
+	(void)uring;
+#endif /* APP_URING */
+
+	if (res != -2)
+	{
+		/* Done by the io_uring backend. */
+	}
+#ifdef APP_POSIX
+	else if (threads > 0u)
+	{
+		res = job_run_pipeline(job, threads);
+	}
+	else
+#endif /* APP_POSIX */
+	{
+		(void)threads;
+		res = job_run_serial(job);
+	}
+
+	return res;
+}
+
+static int encode_file(FILE* ifp, FILE* ofp, const uint8_t* key, int cbc,
+		unsigned int threads, int uring)
+{
+	struct file_job job;
+	size_t file_size;
+	int res;
+
+	job.ifp = ifp;
+	job.ofp = ofp;
+	job.encode = 1;
+	job.cbc = cbc;
+	job.skip = 0;
+	job.left = 0;
+	job.size = 0;
+	encodex_ctx_init(&job.ctx, key);
+
+	file_size = 0;
+	res = get_file_size(ifp, &file_size);
+	if (res == 0)
+	{
+		res = write_header(ofp, file_size);
+	}
+
+	/* The padding goes in front of the data, so the stream of the blocks
+	 * always ends with the last byte of the file. */
+	job.size = file_size;
+	job.pad = ENCODEX_BLOCK_SIZE_BYTES
+		- (file_size % ENCODEX_BLOCK_SIZE_BYTES);
+
+	if (res == 0)
+	{
+		res = job_run(&job, threads, uring);
+	}
+
+	return res;
+}
+
+static int decode_file(FILE* ifp, FILE* ofp, const uint8_t* key, int cbc,
+		unsigned int threads, int uring)
+{
+	struct file_job job;
+	size_t file_size;
+	int res;
+
+	job.ifp = ifp;
+	job.ofp = ofp;
+	job.encode = 0;
+	job.cbc = cbc;
+	job.pad = 0;
+	encodex_ctx_init(&job.ctx, key);
+
+	file_size = 0;
+	res = read_header(ifp, &file_size);
+
+	job.skip = ENCODEX_BLOCK_SIZE_BYTES
+		- (file_size % ENCODEX_BLOCK_SIZE_BYTES);
+	job.left = file_size;
+	job.size = file_size;
+
+	if (res == 0)
+	{
+		res = job_run(&job, threads, uring);
+	}
+
+	return res;
+}
+
+/* Sets the position of the file, the offset may not fit into a long. */
+static int seek_file(FILE* f, size_t offset)
+{
+	int res;
+
+#ifdef APP_POSIX
+	res = (((off_t)offset >= 0) && ((size_t)(off_t)offset == offset)
+			&& (fseeko(f, (off_t)offset, SEEK_SET) == 0)) ? 0 : -1;
+#else
+	size_t left;
+	long step;
+
+	res = fseek(f, 0, SEEK_SET);
+
+	for (left = offset; (res == 0) && (left > 0u); left -= (size_t)step)
+	{
+		step = (left > 0x7fffffffu) ? 0x7fffffffL : (long)left;
+		res = fseek(f, step, SEEK_CUR);
+	}
+#endif /* APP_POSIX */
+
+	return res;
+}
+
+/* Decodes the bytes [offset, offset + length) of the plaintext. The offset
+ * past the stored length is an error, the length is cut at the end. A file
+ * shorter than its header says is an error too. */
+static int decode_file_range(FILE* ifp, FILE* ofp, const uint8_t* key,
+		int cbc, size_t offset, size_t length)
+{
+	struct encodex_ctx ctx;
+	size_t idx;
+	size_t file_size;
+	size_t first;
+	size_t last;
+	size_t block_idx;
+	uint8_t block[ENCODEX_BLOCK_SIZE_BYTES];
+	int res;
+
+	encodex_ctx_init(&ctx, key);
+
+	file_size = 0;
+	res = read_header(ifp, &file_size);
+
+	if ((res == 0) && (offset > file_size))
+	{
+		res = -1;
+	}
+
+	if ((res == 0) && (length > (file_size - offset)))
+	{
+		length = file_size - offset;
+	}
+
+	/* The padding is at the beginning of the encrypted data, so the byte
+	 * N of the file is the byte N + padding of the stream. */
+	first = offset + ENCODEX_BLOCK_SIZE_BYTES
+		- (file_size % ENCODEX_BLOCK_SIZE_BYTES);
+	last = first + length;
+
+	block_idx = first / ENCODEX_BLOCK_SIZE_BYTES;
+	if ((res == 0) && (cbc != 0))
+	{
+		encodex_cbc_seek(&ctx, block_idx);
+	}
+
+	if (res == 0)
+	{
+		res = seek_file(ifp, FILE_HEADER_SIZE
+				+ (block_idx * ENCODEX_BLOCK_SIZE_BYTES));
+	}
+
+	for (idx = block_idx * ENCODEX_BLOCK_SIZE_BYTES;
+			(res == 0) && (idx < last); idx += ENCODEX_BLOCK_SIZE_BYTES)
+	{
+		size_t from;
+		size_t to;
+
+		if (fread(block, ENCODEX_BLOCK_SIZE_BYTES, 1, ifp) != 1u)
+		{
+			res = -1;
+		}
+		else
+		{
+			if (cbc != 0)
+			{
+				encodex_ctx_decode_cbc(&ctx, block, 1);
+			}
+			else
+			{
+				encodex_ctx_decode(&ctx, block);
+			}
+
+			from = (first > idx) ? (first - idx) : 0u;
+			to = ((last - idx) < ENCODEX_BLOCK_SIZE_BYTES)
+				? (last - idx) : ENCODEX_BLOCK_SIZE_BYTES;
+
+			if (fwrite(&block[from], 1, to - from, ofp) != (to - from))
+			{
+				res = -1;
+			}
+		}
+	}
+
+	return res;
+}
+
+/* The stream format needs no seeking: the data is split into frames of at
+ * most IO_BUFFER_SIZE bytes, each one is the 64-bit little-endian plaintext
+ * length followed by the blocks, the last partial block is zero-padded at its
+ * end. A zero length frame marks the end of the stream, so a truncated stream
+ * is detected. The CBC chain continues through the frames. */
+static int encode_stream(FILE* ifp, FILE* ofp, const uint8_t* key, int cbc)
+{
+	struct encodex_ctx ctx;
+	uint8_t* chunk;
+	size_t size;
+	size_t blocks_size;
+	size_t idx;
+	int eof;
+	int res;
+
+	res = 0;
+	eof = 0;
+	encodex_ctx_init(&ctx, key);
+
+	chunk = (uint8_t*)malloc(IO_BUFFER_SIZE);
+	if (chunk == NULL)
+	{
+		res = -1;
+	}
+
+	while ((res == 0) && (eof == 0))
+	{
+		size = fread(chunk, 1, IO_BUFFER_SIZE, ifp);
+		eof = (size < IO_BUFFER_SIZE) ? 1 : 0;
+		blocks_size = ((size + ENCODEX_BLOCK_SIZE_BYTES - 1u)
+				/ ENCODEX_BLOCK_SIZE_BYTES) * ENCODEX_BLOCK_SIZE_BYTES;
+
+		for (idx = size; idx < blocks_size; idx++)
+		{
+			chunk[idx] = 0;
+		}
+
+		if ((eof != 0) && (ferror(ifp) != 0))
+		{
+			res = -1;
+		}
+		else if (size > 0u)
+		{
+			process_blocks(&ctx, chunk, blocks_size / ENCODEX_BLOCK_SIZE_BYTES,
+					1, cbc);
+
+			if ((write_header(ofp, size) != 0)
+					|| (fwrite(chunk, 1, blocks_size, ofp) != blocks_size))
+			{
+				res = -1;
+			}
+		}
+		else
+		{
+		}
+	}
+
+	if (res == 0)
+	{
+		res = write_header(ofp, 0);
+	}
+
+	free(chunk);
+
+	return res;
+}
+
+static int decode_stream(FILE* ifp, FILE* ofp, const uint8_t* key, int cbc)
+{
+	struct encodex_ctx ctx;
+	uint8_t* chunk;
+	size_t size;
+	size_t blocks_size;
+	int res;
+
+	res = 0;
+	size = 1;
+	encodex_ctx_init(&ctx, key);
+
+	chunk = (uint8_t*)malloc(IO_BUFFER_SIZE);
+	if (chunk == NULL)
+	{
+		res = -1;
+	}
+
+	while ((res == 0) && (size > 0u))
+	{
+		res = read_header(ifp, &size);
+		blocks_size = ((size + ENCODEX_BLOCK_SIZE_BYTES - 1u)
+				/ ENCODEX_BLOCK_SIZE_BYTES) * ENCODEX_BLOCK_SIZE_BYTES;
+
+		if ((res != 0) || (size > IO_BUFFER_SIZE))
+		{
+			res = -1;
+		}
+		else if (fread(chunk, 1, blocks_size, ifp) != blocks_size)
+		{
+			res = -1;
+		}
+		else
+		{
+			process_blocks(&ctx, chunk, blocks_size / ENCODEX_BLOCK_SIZE_BYTES,
+					0, cbc);
+
+			if (fwrite(chunk, 1, size, ofp) != size)
+			{
+				res = -1;
+			}
+		}
+	}
+
+	free(chunk);
+
+	return res;
+}
+
+/* The indexed format splits the data into chunks of IO_BUFFER_SIZE plaintext
+ * bytes, each one is chained on its own with the key derived from the main
+ * key and the chunk number, the last partial block is zero-padded at its end.
+ * The footer after the chunks is the index, the 64-bit little-endian offset
+ * and plaintext length of every chunk, and the trailer: the number of the
+ * chunks, the plaintext length and the magic. Any chunk can be decoded alone,
+ * so the chunks are decoded in parallel and a byte range needs only the
+ * footer and the chunks it covers. */
+#define INDEX_MAGIC "ENCXIDX1"
+#define INDEX_ENTRY_SIZE 16u
+#define INDEX_TRAILER_SIZE 24u
+
+struct indexed_file
+{
+	FILE* ifp;
+	uint8_t* index;
+	size_t chunks_num;
+	size_t size;
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+	int cbc;
+};
+
+/* The chunk key is the main key encrypted with the chunk number. */
+static void indexed_chunk_ctx(struct encodex_ctx* ctx, const uint8_t* key,
+		size_t seq)
+{
+	uint8_t block[ENCODEX_BLOCK_SIZE_BYTES];
+	size_t idx;
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
+		block[idx] = key[idx % ENCODEX_KEY_SIZE_BYTES];
+	}
+
+	store_le64(block, seq ^ load_le64(block));
+	encodex(block, key);
+	encodex_ctx_init(ctx, block);
+}
+
+static int encode_indexed(FILE* ifp, FILE* ofp, const uint8_t* key, int cbc)
+{
+	struct encodex_ctx ctx;
+	uint8_t* chunk;
+	uint8_t* index;
+	uint8_t* grown;
+	uint8_t trailer[INDEX_TRAILER_SIZE];
+	size_t index_cap;
+	size_t chunks_num;
+	size_t offset;
+	size_t total;
+	size_t size;
+	size_t blocks_size;
+	size_t idx;
+	int eof;
+	int res;
+
+	res = 0;
+	eof = 0;
+	index = NULL;
+	index_cap = 0;
+	chunks_num = 0;
+	offset = 0;
+	total = 0;
+
+	chunk = (uint8_t*)malloc(IO_BUFFER_SIZE);
+	if (chunk == NULL)
+	{
+		res = -1;
+	}
+
+	while ((res == 0) && (eof == 0))
+	{
+		size = fread(chunk, 1, IO_BUFFER_SIZE, ifp);
+		eof = (size < IO_BUFFER_SIZE) ? 1 : 0;
+		blocks_size = ((size + ENCODEX_BLOCK_SIZE_BYTES - 1u)
+				/ ENCODEX_BLOCK_SIZE_BYTES) * ENCODEX_BLOCK_SIZE_BYTES;
+
+		for (idx = size; idx < blocks_size; idx++)
+		{
+			chunk[idx] = 0;
+		}
+
+		if (chunks_num == index_cap)
+		{
+			index_cap = (index_cap == 0u) ? 64u : (index_cap * 2u);
+			grown = (uint8_t*)realloc(index, index_cap * INDEX_ENTRY_SIZE);
+			if (grown == NULL)
+			{
+				res = -1;
+			}
+			else
+			{
+				index = grown;
+			}
+		}
+
+		if ((res != 0) || ((eof != 0) && (ferror(ifp) != 0)))
+		{
+			res = -1;
+		}
+		else if (size > 0u)
+		{
+			indexed_chunk_ctx(&ctx, key, chunks_num);
+			process_blocks(&ctx, chunk, blocks_size / ENCODEX_BLOCK_SIZE_BYTES,
+					1, cbc);
+
+			store_le64(&index[chunks_num * INDEX_ENTRY_SIZE], offset);
+			store_le64(&index[(chunks_num * INDEX_ENTRY_SIZE) + 8u], size);
+			chunks_num++;
+			offset += blocks_size;
+			total += size;
+
+			if (fwrite(chunk, 1, blocks_size, ofp) != blocks_size)
+			{
+				res = -1;
+			}
+		}
+		else
+		{
+		}
+	}
+
+	if (res == 0)
+	{
+		store_le64(&trailer[0], chunks_num);
+		store_le64(&trailer[8], total);
+		(void)memcpy(&trailer[16], INDEX_MAGIC, 8);
+
+		if (((chunks_num > 0u) && (fwrite(index, INDEX_ENTRY_SIZE, chunks_num,
+						ofp) != chunks_num))
+				|| (fwrite(trailer, 1, INDEX_TRAILER_SIZE, ofp)
+					!= INDEX_TRAILER_SIZE))
+		{
+			res = -1;
+		}
+	}
+
+	free(index);
+	free(chunk);
+
+	return res;
+}
+
+/* Reads size bytes at the offset, the POSIX version doesn't move the file
+ * position, so the threads can share the file. */
+static int read_at(FILE* f, size_t offset, uint8_t* buf, size_t size)
+{
+	int res;
+
+#ifdef APP_POSIX
+	res = (pread(fileno(f), buf, size, (off_t)offset) == (ssize_t)size)
+		? 0 : -1;
+#else
+	res = ((seek_file(f, offset) == 0)
+			&& (fread(buf, 1, size, f) == size)) ? 0 : -1;
+#endif /* APP_POSIX */
+
+	return res;
+}
+
+static int indexed_load(struct indexed_file* file)
+{
+	uint8_t trailer[INDEX_TRAILER_SIZE];
+	size_t file_size;
+	size_t index_size;
+	size_t data_size;
+	size_t idx;
+	int res;
+
+	file->index = NULL;
+	file->chunks_num = 0;
+	file->size = 0;
+	file_size = 0;
+	index_size = 0;
+
+	res = get_file_size(file->ifp, &file_size);
+	if ((res == 0) && (file_size < INDEX_TRAILER_SIZE))
+	{
+		res = -1;
+	}
+
+	if (res == 0)
+	{
+		res = read_at(file->ifp, file_size - INDEX_TRAILER_SIZE,
+				trailer, INDEX_TRAILER_SIZE);
+	}
+
+	if ((res == 0) && (memcmp(&trailer[16], INDEX_MAGIC, 8) == 0))
+	{
+		file->chunks_num = load_le64(&trailer[0]);
+		file->size = load_le64(&trailer[8]);
+		index_size = file->chunks_num * INDEX_ENTRY_SIZE;
+		data_size = file_size - INDEX_TRAILER_SIZE;
+
+		if ((file->chunks_num > (data_size / INDEX_ENTRY_SIZE))
+				|| (file->chunks_num != ((file->size + IO_BUFFER_SIZE - 1u)
+						/ IO_BUFFER_SIZE)))
+		{
+			res = -1;
+		}
+	}
+	else
+	{
+		res = -1;
+	}
+
+	if ((res == 0) && (index_size > 0u))
+	{
+		file->index = (uint8_t*)malloc(index_size);
+		res = (file->index == NULL) ? -1 : read_at(file->ifp,
+				file_size - INDEX_TRAILER_SIZE - index_size,
+				file->index, index_size);
+	}
+
+	/* Every chunk but the last one is full. */
+	for (idx = 0; (res == 0) && (idx < file->chunks_num); idx++)
+	{
+		if (load_le64(&file->index[(idx * INDEX_ENTRY_SIZE) + 8u])
+				!= ((idx + 1u < file->chunks_num) ? IO_BUFFER_SIZE
+					: (file->size - (idx * IO_BUFFER_SIZE))))
+		{
+			res = -1;
+		}
+	}
+
+	return res;
+}
+
+/* Decodes the chunk seq into the buffer, from and out are set to the part of
+ * the chunk inside the byte range. */
+static int indexed_decode_chunk(const struct indexed_file* file, size_t seq,
+		uint8_t* buf, size_t offset, size_t length, size_t* from, size_t* out)
+{
+	struct encodex_ctx ctx;
+	size_t start;
+	size_t size;
+	size_t blocks_size;
+	size_t first;
+	size_t last;
+	int res;
+
+	start = seq * IO_BUFFER_SIZE;
+	size = load_le64(&file->index[(seq * INDEX_ENTRY_SIZE) + 8u]);
+	first = (offset > start) ? (offset - start) : 0u;
+	last = ((offset + length) < (start + size))
+		? ((offset + length) - start) : size;
+
+	/* ECB blocks are independent, only the blocks of the range are read. */
+	if (file->cbc != 0)
+	{
+		first = 0;
+	}
+
+	first = (first / ENCODEX_BLOCK_SIZE_BYTES) * ENCODEX_BLOCK_SIZE_BYTES;
+	blocks_size = ((last + ENCODEX_BLOCK_SIZE_BYTES - 1u)
+			/ ENCODEX_BLOCK_SIZE_BYTES) * ENCODEX_BLOCK_SIZE_BYTES;
+
+	res = read_at(file->ifp,
+			load_le64(&file->index[seq * INDEX_ENTRY_SIZE]) + first,
+			&buf[first], blocks_size - first);
+
+	if (res == 0)
+	{
+		indexed_chunk_ctx(&ctx, file->key, seq);
+		process_blocks(&ctx, &buf[first],
+				(blocks_size - first) / ENCODEX_BLOCK_SIZE_BYTES, 0, file->cbc);
+
+		*from = (offset > start) ? (offset - start) : 0u;
+		*out = last - *from;
+	}
+
+	return res;
+}
+
+#ifdef APP_POSIX
+
+struct indexed_worker
+{
+	pthread_t thread;
+	const struct indexed_file* file;
+	int fd;
+	off_t base;
+	size_t first;
+	size_t last;
+	size_t step;
+	size_t offset;
+	size_t length;
+	int res;
+};
+
+/* Every worker takes each step-th chunk and writes the result at its place
+ * in the output file. */
+static void* indexed_worker(void* arg)
+{
+	struct indexed_worker* worker;
+	uint8_t* buf;
+	size_t seq;
+	size_t from;
+	size_t out;
+	size_t pos;
+
+	worker = (struct indexed_worker*)arg;
+	worker->res = 0;
+
+	buf = (uint8_t*)malloc(IO_BUFFER_SIZE);
+	if (buf == NULL)
+	{
+		worker->res = -1;
+	}
+
+	for (seq = worker->first; (worker->res == 0) && (seq < worker->last);
+			seq += worker->step)
+	{
+		worker->res = indexed_decode_chunk(worker->file, seq, buf,
+				worker->offset, worker->length, &from, &out);
+
+		pos = (seq * IO_BUFFER_SIZE) + from - worker->offset;
+		if ((worker->res == 0) && (pwrite(worker->fd, &buf[from], out,
+						worker->base + (off_t)pos) != (ssize_t)out))
+		{
+			worker->res = -1;
+		}
+	}
+
+	free(buf);
+
+	return NULL;
+}
+
+static int decode_indexed_parallel(const struct indexed_file* file, FILE* ofp,
+		size_t first, size_t last, size_t offset, size_t length,
+		unsigned int threads)
+{
+	struct indexed_worker* workers;
+	struct stat st;
+	size_t started;
+	size_t idx;
+	off_t base;
+	int res;
+
+	res = 0;
+	started = 0;
+	base = ftello(ofp);
+
+	if ((fstat(fileno(ofp), &st) != 0) || (S_ISREG(st.st_mode) == 0)
+			|| (base < 0) || (fflush(ofp) != 0))
+	{
+		/* Not a regular file, the caller decodes serially. */
+		res = -2;
+	}
+
+	workers = (struct indexed_worker*)malloc(threads * sizeof(*workers));
+	if ((res == 0) && (workers == NULL))
+	{
+		res = -2;
+	}
+
+	for (idx = 0; (res == 0) && (idx < threads); idx++)
+	{
+		workers[idx].file = file;
+		workers[idx].fd = fileno(ofp);
+		workers[idx].base = base;
+		workers[idx].first = first + idx;
+		workers[idx].last = last;
+		workers[idx].step = threads;
+		workers[idx].offset = offset;
+		workers[idx].length = length;
+		workers[idx].res = 0;
+	}
+
+	for (idx = 0; (res == 0) && (idx < threads); idx++)
+	{
+		if ((started == idx) && (pthread_create(&workers[idx].thread, NULL,
+						indexed_worker, &workers[idx]) == 0))
+		{
+			started++;
+		}
+		else
+		{
+			/* The chunks of the workers that failed to start are done
+			 * by the calling thread. */
+			(void)indexed_worker(&workers[idx]);
+			res = workers[idx].res;
+		}
+	}
+
+	for (idx = 0; idx < started; idx++)
+	{
+		(void)pthread_join(workers[idx].thread, NULL);
+		res = (workers[idx].res != 0) ? -1 : res;
+	}
+
+	free(workers);
+
+	return res;
+}
+
+#endif /* APP_POSIX */
+
+static int decode_indexed(FILE* ifp, FILE* ofp, const uint8_t* key, int cbc,
+		size_t offset, size_t length, unsigned int threads)
+{
+	struct indexed_file file;
+	uint8_t* buf;
+	size_t first;
+	size_t last;
+	size_t seq;
+	size_t from;
+	size_t out;
+	int res;
+
+	buf = NULL;
+	file.ifp = ifp;
+	file.cbc = cbc;
+	(void)memcpy(file.key, key, ENCODEX_KEY_SIZE_BYTES);
+
+	res = indexed_load(&file);
+
+	if ((res == 0) && (offset > file.size))
+	{
+		res = -1;
+	}
+
+	offset = (offset < file.size) ? offset : file.size;
+	length = (length < (file.size - offset)) ? length : (file.size - offset);
+	first = offset / IO_BUFFER_SIZE;
+	last = (length > 0u) ? (((offset + length - 1u) / IO_BUFFER_SIZE) + 1u)
+		: first;
+
+#ifdef APP_POSIX
+	if ((res == 0) && (threads > 1u) && ((last - first) > 1u))
+	{
+		res = decode_indexed_parallel(&file, ofp, first, last,
+				offset, length, threads);
+		first = (res == -2) ? first : last;
+		res = (res == -2) ? 0 : res;
+	}
+#else
+	(void)threads;
+#endif /* APP_POSIX */
+
+	if ((res == 0) && (first < last))
+	{
+		buf = (uint8_t*)malloc(IO_BUFFER_SIZE);
+		res = (buf == NULL) ? -1 : 0;
+	}
+
+	for (seq = first; (res == 0) && (seq < last); seq++)
+	{
+		res = indexed_decode_chunk(&file, seq, buf, offset, length,
+				&from, &out);
+
+		if ((res == 0) && (fwrite(&buf[from], 1, out, ofp) != out))
+		{
+			res = -1;
+		}
+	}
+
+	free(buf);
+	free(file.index);
+
+	return res;
+}
+
+#ifdef APP_POSIX
+
+/* The in-place layout keeps every block at the offset of its plaintext: the
+ * last partial block is zero-padded at its end and the 64-bit little-endian
+ * plaintext length follows the blocks. */
+static int inplace_file(const char* path, const uint8_t* key,
+		int encode, int cbc)
+{
+	struct encodex_ctx ctx;
+	struct stat st;
+	uint8_t* map;
+	size_t data_size;
+	size_t map_size;
+	size_t file_size;
+	int fd;
+	int res;
+
+	res = 0;
+	map = NULL;
+	map_size = 0;
+	file_size = 0;
+	data_size = 0;
+
+	fd = open(path, O_RDWR);
+	if ((fd < 0) || (fstat(fd, &st) != 0))
+	{
+		res = -1;
+	}
+
+	if ((res == 0) && (encode != 0))
+	{
+		file_size = (size_t)st.st_size;
+		data_size = ((file_size + ENCODEX_BLOCK_SIZE_BYTES - 1u)
+				/ ENCODEX_BLOCK_SIZE_BYTES) * ENCODEX_BLOCK_SIZE_BYTES;
+		map_size = data_size + 8u;
+
+		if (ftruncate(fd, (off_t)map_size) != 0)
+		{
+			res = -1;
+		}
+	}
+	else if (res == 0)
+	{
+		map_size = (size_t)st.st_size;
+		data_size = map_size - 8u;
+
+		if ((map_size < 8u) || ((data_size % ENCODEX_BLOCK_SIZE_BYTES) != 0u))
+		{
+			res = -1;
+		}
+	}
+	else
+	{
+	}
+
+	if (res == 0)
+	{
+		map = (uint8_t*)mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED, fd, 0);
+		if (map == (uint8_t*)MAP_FAILED)
+		{
+			map = NULL;
+			res = -1;
+		}
+	}
+
+	if ((res == 0) && (encode == 0))
+	{
+		file_size = load_le64(&map[data_size]);
+
+		if ((file_size > data_size)
+				|| ((data_size - file_size) >= ENCODEX_BLOCK_SIZE_BYTES))
+		{
+			res = -1;
+		}
+	}
+
+	if (res == 0)
+	{
+		(void)posix_madvise(map, map_size, POSIX_MADV_SEQUENTIAL);
+
+		encodex_ctx_init(&ctx, key);
+		process_blocks(&ctx, map, data_size / ENCODEX_BLOCK_SIZE_BYTES,
+				encode, cbc);
+
+		if (encode != 0)
+		{
+			store_le64(&map[data_size], file_size);
+		}
+	}
+
+	if (map != NULL)
+	{
+		(void)munmap(map, map_size);
+	}
+
+	if ((res == 0) && (encode == 0))
+	{
+		if (ftruncate(fd, (off_t)file_size) != 0)
+		{
+			res = -1;
+		}
+	}
+
+	if (fd >= 0)
+	{
+		(void)close(fd);
+	}
+
+	return res;
+}
+
+#else
+
+static int inplace_file(const char* path, const uint8_t* key,
+		int encode, int cbc)
+{
+	(void)path;
+	(void)key;
+	(void)encode;
+	(void)cbc;
+	(void)printf("In-place mode is not supported on this platform\n");
+
+	return -1;
+}
+
+#endif /* APP_POSIX */
+
+int main(int argc, char** argv)
+{
+	struct cli_result cr;
+	FILE* ifp;
+	FILE* ofp;
+
+	int close_ifp;
+	int close_ofp;
+
+	uint8_t allow;
+	int retval;
+
+	close_ifp = 0;
+	close_ofp = 0;
+
+	allow = 1u;
+	retval = 0;
+	
+	cr = cli(argc, argv);
+
+	if (cr.error != 0)
+	{
+		print_error(cr.error);
+		print_help();
+		allow = 0;
+		retval = -1;
+	}
+
+	if (allow == 1u)
+	{
+		if (cr.help != 0)
+		{
+			print_help();
+			allow = 0;
+			retval = 0;
+		}
+	}
+
+	if ((allow == 1u) && (cr.engine == ENGINE_SBOX))
+	{
+		ecb_sbox = (struct encodex_sbox*)malloc(sizeof(*ecb_sbox));
+		if (ecb_sbox == NULL)
+		{
+			(void)fprintf(stderr, "Not enough memory\n");
+			allow = 0;
+			retval = -1;
+		}
+		else
+		{
+			encodex_sbox_init(ecb_sbox, cr.key);
+		}
+	}
+
+	ecb_engine = cr.engine;
+
+	if ((allow == 1u) && (cr.inplace != 0))
+	{
+		retval = inplace_file(cr.ifile, cr.key, cr.encode, cr.cbc);
+		if (retval != 0)
+		{
+			(void)fprintf(stderr, "Can't process %s\n", cr.ifile);
+		}
+
+		allow = 0;
+	}
+
+	if (allow == 1u)
+	{
+		if (strcmp("-", cr.ifile) == 0)
 		{
-			close_ofp = 1;
+			ifp = stdin;
+		}
+		else
+		{
+			ifp = fopen(cr.ifile, "rb");
+			close_ifp = (ifp != NULL) ? 1 : 0;
+		}
+
+		if (ifp == NULL)
+		{
+			(void)fprintf(stderr, "Can't open %s\n", cr.ifile);
+			allow = 0;
+			retval = -1;
+		}
+	}
+
+	if (allow == 1u)
+	{
+		if (strcmp("-", cr.ofile) == 0)
+		{
+			ofp = stdout;
+		}
+		else
+		{
+			ofp = fopen(cr.ofile, "wb");
+			close_ofp = (ofp != NULL) ? 1 : 0;
+		}
+
+		if (ofp == NULL)
+		{
+			(void)fprintf(stderr, "Can't open %s\n", cr.ofile);
+			allow = 0;
+			retval = -1;
 		}
 	}
 
 	if (allow == 1u)
 	{
-		if (cr.encode && !cr.cbc)
+		if ((cr.indexed != 0) && (cr.encode != 0))
 		{
-			encode_file(ifp, ofp, cr.key);
+			retval = encode_indexed(ifp, ofp, cr.key, cr.cbc);
 		}
-		else if (cr.encode && cr.cbc)
+		else if (cr.indexed != 0)
 		{
-			encode_file_cbc(ifp, ofp, cr.key);
+			retval = decode_indexed(ifp, ofp, cr.key, cr.cbc,
+					cr.offset, cr.length, cr.threads);
 		}
-		else if (!cr.encode && !cr.cbc)
+		else if ((cr.stream != 0) && (cr.encode != 0))
 		{
-			decode_file(ifp, ofp, cr.key);
+			retval = encode_stream(ifp, ofp, cr.key, cr.cbc);
 		}
-		else if (!cr.encode && cr.cbc)
+		else if (cr.stream != 0)
 		{
-			decode_file_cbc(ifp, ofp, cr.key);
+			retval = decode_stream(ifp, ofp, cr.key, cr.cbc);
+		}
+		else if (cr.range != 0)
+		{
+			retval = decode_file_range(ifp, ofp, cr.key, cr.cbc,
+					cr.offset, cr.length);
+		}
+		else if (cr.encode != 0)
+		{
+			retval = encode_file(ifp, ofp, cr.key, cr.cbc,
+					cr.threads, cr.uring);
 		}
 		else
 		{
+			retval = decode_file(ifp, ofp, cr.key, cr.cbc,
+					cr.threads, cr.uring);
+		}
+
+		if (retval != 0)
+		{
+			(void)fprintf(stderr, "Can't process %s\n", cr.ifile);
 		}
 	}
 
@@ -504,5 +2524,7 @@ int main(int argc, char** argv)
 		(void)fclose(ofp);
 	}
 
+	free(ecb_sbox);
+
 	return retval;
 }
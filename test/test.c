@@ -19,23 +19,88 @@
  * DEALINGS IN THE SOFTWARE. */
 
 #include "encodex.c"
+#include "encodex_simd.h"
+#include "encodex_mt.h"
+#include "encodex_cache.h"
+#include "encodex_sbox.h"
 
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
+
+/** \brief Restores the value that was before XOR operation with left shift.
+ *         Each step doubles the number of the restored low bits.
+ *  \param val The word to restore.
+ *  \param shift Value of the previous shift. Should be greater than 0 and
+ *               not greater than 31. */
+static uint32_t revert_lshift(uint32_t val, size_t shift)
+{
+	uint32_t res;
+	register size_t step;
+
+	res = val;
+
+	for (step = shift; step < (sizeof(uint32_t) * 8u); step <<= 1u)
+	{
+		res ^= res << step;
+	}
+
+	return res;
+}
+
+/** \brief Restores the value that was before XOR operation with right shift.
+ *         Each step doubles the number of the restored high bits.
+ *  \param val The word to restore.
+ *  \param shift Value of the previous shift. Should be greater than 0 and
+ *               not greater than 31. */
+static uint32_t revert_rshift(uint32_t val, size_t shift)
+{
+	uint32_t res;
+	register size_t step;
+
+	res = val;
+
+	for (step = shift; step < (sizeof(uint32_t) * 8u); step <<= 1u)
+	{
+		res ^= res >> step;
+	}
+
+	return res;
+}
+
+/** \brief Restores the previous value in the pseudo-random sequence. The
+ *         cypher itself never walks the sequence backward, the inverse is
+ *         here only to check that the generator is a bijection.
+ *  \param current Current pseudo-random value.
+ *  \return The previous pseudo-random value. */
+static uint32_t prnd_prev(uint32_t current)
+{
+	uint32_t _current;
+
+	_current = current;
+	_current = revert_lshift(_current,  4u);
+	_current = revert_rshift(_current, 17u);
+	_current = revert_lshift(_current, 13u);
+
+	return _current;
+}
 
 static void random_check(void)
 {
 	size_t i;
 	uint32_t values[10];
+	uint32_t state;
 	uint32_t tmp;
 
 	printf("\nPseudo-random number generator\n");
 
+	state = 0xc0ffee;
 	for (i = 0; i < 10u; i++)
 	{
-		values[i] = prnd();
+		values[i] = prnd(&state);
 	}
 
-	tmp = prnd();
+	tmp = prnd(&state);
 
 	for (i = 0; i < 10u; i++)
 	{
@@ -110,6 +175,10 @@ static void rol_check(void)
 	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
 	{
 		key[idx] = 5;
+	}
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
 		mem[idx] = 0x01;
 		exp[idx] = mem[idx];
 	}
@@ -133,6 +202,10 @@ static void add_check_key(void)
 	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
 	{
 		key[idx] = 0xff;
+	}
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
 		mem[idx] = 0x01;
 		exp[idx] = mem[idx];
 	}
@@ -156,6 +229,10 @@ static void noize_denoize_check(void)
 	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
 	{
 		key[idx] = 0xff;
+	}
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
 		mem[idx] = 0x01;
 		exp[idx] = mem[idx];
 	}
@@ -179,6 +256,10 @@ static void shuffle_check(void)
 	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
 	{
 		key[idx] = 0xff & (0x01 + idx * 3);
+	}
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
 		mem[idx] = idx;
 		exp[idx] = mem[idx];
 	}
@@ -202,6 +283,10 @@ static void encodex_check(void)
 	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
 	{
 		key[idx] = 0xff & (0x01 + idx * 3);
+	}
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
 		mem[idx] = idx;
 		exp[idx] = mem[idx];
 	}
@@ -213,6 +298,243 @@ static void encodex_check(void)
 	printf("	%s\n", compare(mem, exp) == 0 ? "OK" : "fail");
 }
 
+static void encodex_ecb_check(void)
+{
+	size_t idx;
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+	uint8_t mem[ENCODEX_BLOCK_SIZE_BYTES * 10];
+	uint8_t exp[ENCODEX_BLOCK_SIZE_BYTES * 10];
+	size_t counter;
+
+	printf("\nENCODEX ECB check\n");
+
+	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+	{
+		key[idx] = 0xff & (0x01 + idx * 3);
+	}
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 10; idx++)
+	{
+		mem[idx] = idx % 256;
+		exp[idx] = mem[idx];
+	}
+
+	encodex_ecb(mem, 10, key);
+	for (idx = 0; idx < 10; idx++)
+	{
+		encodex(exp + idx * ENCODEX_BLOCK_SIZE_BYTES, key);
+	}
+
+	counter = 0;
+	for (idx = 0; idx < 10; idx++)
+	{
+		counter += compare(
+			mem + idx * ENCODEX_BLOCK_SIZE_BYTES,
+			exp + idx * ENCODEX_BLOCK_SIZE_BYTES);
+	}
+
+	decodex_ecb(mem, 10, key);
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 10; idx++)
+	{
+		exp[idx] = idx % 256;
+	}
+
+	for (idx = 0; idx < 10; idx++)
+	{
+		counter += compare(
+			mem + idx * ENCODEX_BLOCK_SIZE_BYTES,
+			exp + idx * ENCODEX_BLOCK_SIZE_BYTES);
+	}
+
+	printf("	%s\n", counter == 0 ? "OK" : "fail");
+}
+
+static void encodex_simd_check(void)
+{
+	size_t idx;
+	size_t round;
+	int simd;
+	struct encodex_schedule sched;
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+	uint8_t mem[ENCODEX_BLOCK_SIZE_BYTES * 10];
+	uint8_t exp[ENCODEX_BLOCK_SIZE_BYTES * 10];
+	size_t counter;
+
+	printf("\nENCODEX SIMD check, best kernel: %s\n",
+			encodex_simd_name(encodex_simd_detect()));
+
+	counter = 0;
+	for (simd = ENCODEX_SIMD_NONE; simd <= (int)encodex_simd_detect(); simd++)
+	{
+		for (round = 0; round < 4; round++)
+		{
+			for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+			{
+				key[idx] = 0xff & (0x01 + idx * (3 + round * 7));
+			}
+
+			for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 10; idx++)
+			{
+				mem[idx] = 0xff & (idx * 5 + round);
+				exp[idx] = mem[idx];
+			}
+
+			encodex_schedule_init(&sched, key);
+			encodex_simd_encode((enum encodex_simd)simd, &sched, mem, 10);
+			encodex_ecb(exp, 10, key);
+
+			for (idx = 0; idx < 10; idx++)
+			{
+				counter += compare(
+					mem + idx * ENCODEX_BLOCK_SIZE_BYTES,
+					exp + idx * ENCODEX_BLOCK_SIZE_BYTES);
+			}
+
+			encodex_simd_decode((enum encodex_simd)simd, &sched, mem, 10);
+			decodex_ecb(exp, 10, key);
+
+			for (idx = 0; idx < 10; idx++)
+			{
+				counter += compare(
+					mem + idx * ENCODEX_BLOCK_SIZE_BYTES,
+					exp + idx * ENCODEX_BLOCK_SIZE_BYTES);
+			}
+		}
+	}
+
+	printf("	%s\n", counter == 0 ? "OK" : "fail");
+}
+
+static void encodex_simd_batch_check(void)
+{
+	size_t idx;
+	size_t pair;
+	int simd;
+	uint8_t keys[ENCODEX_KEY_SIZE_BYTES * 19];
+	uint8_t mem[ENCODEX_BLOCK_SIZE_BYTES * 19];
+	uint8_t exp[ENCODEX_BLOCK_SIZE_BYTES * 19];
+	size_t counter;
+
+	printf("\nENCODEX SIMD batch check\n");
+
+	for (pair = 0; pair < 19; pair++)
+	{
+		for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+		{
+			/* Pairs 3 and 9 have keys convoluted to zero. */
+			if (pair == 3)
+			{
+				keys[pair * ENCODEX_KEY_SIZE_BYTES + idx] = 0;
+			}
+			else if (pair == 9)
+			{
+				keys[pair * ENCODEX_KEY_SIZE_BYTES + idx] = 0x5a;
+			}
+			else
+			{
+				keys[pair * ENCODEX_KEY_SIZE_BYTES + idx] =
+					0xff & (0x01 + pair * 11 + idx * (3 + pair * 7));
+			}
+		}
+	}
+
+	counter = 0;
+	for (simd = ENCODEX_SIMD_NONE; simd <= (int)encodex_simd_detect(); simd++)
+	{
+		for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 19; idx++)
+		{
+			mem[idx] = 0xff & (idx * 5 + simd);
+			exp[idx] = mem[idx];
+		}
+
+		encodex_simd_batch_encode((enum encodex_simd)simd, mem, keys, 19);
+
+		for (pair = 0; pair < 19; pair++)
+		{
+			encodex(exp + pair * ENCODEX_BLOCK_SIZE_BYTES,
+					keys + pair * ENCODEX_KEY_SIZE_BYTES);
+			counter += compare(
+				mem + pair * ENCODEX_BLOCK_SIZE_BYTES,
+				exp + pair * ENCODEX_BLOCK_SIZE_BYTES);
+		}
+
+		encodex_simd_batch_decode((enum encodex_simd)simd, mem, keys, 19);
+
+		for (pair = 0; pair < 19; pair++)
+		{
+			decodex(exp + pair * ENCODEX_BLOCK_SIZE_BYTES,
+					keys + pair * ENCODEX_KEY_SIZE_BYTES);
+			counter += compare(
+				mem + pair * ENCODEX_BLOCK_SIZE_BYTES,
+				exp + pair * ENCODEX_BLOCK_SIZE_BYTES);
+		}
+
+		for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 19; idx++)
+		{
+			counter += mem[idx] != (0xff & (idx * 5 + simd));
+		}
+	}
+
+	printf("	%s\n", counter == 0 ? "OK" : "fail");
+}
+
+static void encodex_sbox_check(void)
+{
+	size_t idx;
+	size_t round;
+	static struct encodex_sbox sbox;
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+	uint8_t mem[ENCODEX_BLOCK_SIZE_BYTES * 10];
+	uint8_t exp[ENCODEX_BLOCK_SIZE_BYTES * 10];
+	size_t counter;
+
+	printf("\nENCODEX S-box check\n");
+
+	counter = 0;
+	for (round = 0; round < 5; round++)
+	{
+		/* The last round has the key convoluted to zero. */
+		for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+		{
+			key[idx] = (round < 4) ? 0xff & (0x01 + idx * (3 + round * 7)) : 0;
+		}
+
+		for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 10; idx++)
+		{
+			mem[idx] = 0xff & (idx * 5 + round);
+			exp[idx] = mem[idx];
+		}
+
+		encodex_sbox_init(&sbox, key);
+		encodex_sbox_encode(&sbox, mem, 10);
+		encodex_ecb(exp, 10, key);
+
+		for (idx = 0; idx < 10; idx++)
+		{
+			counter += compare(
+				mem + idx * ENCODEX_BLOCK_SIZE_BYTES,
+				exp + idx * ENCODEX_BLOCK_SIZE_BYTES);
+		}
+
+		encodex_sbox_decode(&sbox, mem, 10);
+		decodex_ecb(exp, 10, key);
+
+		for (idx = 0; idx < 10; idx++)
+		{
+			counter += compare(
+				mem + idx * ENCODEX_BLOCK_SIZE_BYTES,
+				exp + idx * ENCODEX_BLOCK_SIZE_BYTES);
+		}
+
+		for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 10; idx++)
+		{
+			counter += mem[idx] != (0xff & (idx * 5 + round));
+		}
+	}
+
+	printf("	%s\n", counter == 0 ? "OK" : "fail");
+}
+
 static void encodex_cbc_check(void)
 {
 	size_t idx;
@@ -248,6 +570,722 @@ static void encodex_cbc_check(void)
 	printf("	%s\n", counter == 0 ? "OK" : "fail");
 }
 
+static void encodex_ctx_check(void)
+{
+	size_t idx;
+	struct encodex_ctx ctx;
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+	uint8_t mem[ENCODEX_BLOCK_SIZE_BYTES * 10];
+	uint8_t exp[ENCODEX_BLOCK_SIZE_BYTES * 10];
+	size_t counter;
+
+	printf("\nENCODEX context check\n");
+
+	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+	{
+		key[idx] = 0xff & (0x01 + idx * 3);
+	}
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 10; idx++)
+	{
+		mem[idx] = idx % 256;
+		exp[idx] = mem[idx];
+	}
+
+	encodex_cbc(exp, 10, key);
+
+	encodex_ctx_init(&ctx, key);
+	encodex_ctx_encode_cbc(&ctx, mem, 3);
+	encodex_ctx_encode_cbc(&ctx, mem + ENCODEX_BLOCK_SIZE_BYTES * 3, 7);
+
+	counter = 0;
+	for (idx = 0; idx < 10; idx++)
+	{
+		counter += compare(
+			mem + idx * ENCODEX_BLOCK_SIZE_BYTES,
+			exp + idx * ENCODEX_BLOCK_SIZE_BYTES);
+	}
+
+	encodex_ctx_init(&ctx, key);
+	encodex_ctx_decode_cbc(&ctx, mem, 10);
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+	{
+		exp[idx] = idx % 256;
+	}
+	counter += compare(mem, exp);
+
+	encodex_ctx_encode(&ctx, mem);
+	encodex(exp, key);
+	counter += compare(mem, exp);
+
+	printf("	%s\n", counter == 0 ? "OK" : "fail");
+}
+
+static void encodex_schedule_check(void)
+{
+	size_t idx;
+	size_t round;
+	struct encodex_schedule sched;
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+	uint8_t mem[ENCODEX_BLOCK_SIZE_BYTES];
+	uint8_t exp[ENCODEX_BLOCK_SIZE_BYTES];
+	size_t counter;
+
+	printf("\nENCODEX key schedule check\n");
+
+	counter = 0;
+	for (round = 0; round < 4; round++)
+	{
+		for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+		{
+			key[idx] = 0xff & (0x01 + idx * (3 + round * 7));
+		}
+
+		for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES; idx++)
+		{
+			mem[idx] = 0xff & (idx * 5 + round);
+			exp[idx] = mem[idx];
+		}
+
+		encodex_schedule_init(&sched, key);
+		encodex_schedule_encode(&sched, mem);
+		encodex(exp, key);
+		counter += compare(mem, exp);
+
+		encodex_schedule_decode(&sched, mem);
+		decodex(exp, key);
+		counter += compare(mem, exp);
+	}
+
+	printf("	%s\n", counter == 0 ? "OK" : "fail");
+}
+
+/* Keys and schedules shared by the cache check threads. */
+#define CACHE_CHECK_KEYS 100
+
+static uint8_t cache_check_keys[CACHE_CHECK_KEYS][ENCODEX_KEY_SIZE_BYTES];
+static struct encodex_schedule cache_check_scheds[CACHE_CHECK_KEYS];
+
+static void cache_check_key(uint8_t* key, size_t num)
+{
+	size_t idx;
+
+	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+	{
+		key[idx] = 0xff & (num * 13 + idx * (5 + num * 2));
+	}
+}
+
+static void* cache_check_worker(void* arg)
+{
+	size_t idx;
+	size_t num;
+	size_t counter;
+	const struct encodex_cached_schedule* sched;
+
+	counter = 0;
+	num = 0;
+	for (idx = 0; idx < 5000; idx++)
+	{
+		num = (num * 7 + idx) % CACHE_CHECK_KEYS;
+		sched = encodex_schedule_cache_acquire(
+				(struct encodex_schedule_cache*)arg, cache_check_keys[num]);
+
+		if (sched != NULL)
+		{
+			counter += memcmp(sched->key, cache_check_keys[num],
+					ENCODEX_KEY_SIZE_BYTES) != 0;
+			counter += memcmp(&sched->schedule, &cache_check_scheds[num],
+					sizeof(sched->schedule)) != 0;
+			encodex_schedule_cache_release(
+					(struct encodex_schedule_cache*)arg, sched);
+		}
+	}
+
+	return counter != 0 ? arg : NULL;
+}
+
+static void encodex_schedule_cache_check(void)
+{
+	size_t idx;
+	size_t num;
+	size_t hits;
+	size_t misses;
+	uint32_t seed;
+	struct encodex_ctx ctx;
+	struct encodex_schedule_cache* cache;
+	const struct encodex_cached_schedule* held[ENCODEX_CACHE_SHARDS + 1];
+	const struct encodex_cached_schedule* sched;
+	pthread_t threads[4];
+	uint8_t mem[ENCODEX_BLOCK_SIZE_BYTES * 3];
+	uint8_t exp[ENCODEX_BLOCK_SIZE_BYTES * 3];
+	size_t counter;
+
+	printf("\nENCODEX schedule cache check\n");
+
+	for (num = 0; num < CACHE_CHECK_KEYS; num++)
+	{
+		cache_check_key(cache_check_keys[num], num);
+		encodex_schedule_init(&cache_check_scheds[num], cache_check_keys[num]);
+	}
+
+	counter = 0;
+
+	/* One entry per shard, the keys evict each other. */
+	cache = encodex_schedule_cache_create(ENCODEX_CACHE_SHARDS);
+	counter += cache == NULL;
+
+	for (num = 0; (cache != NULL) && (num < 40); num++)
+	{
+		sched = encodex_schedule_cache_acquire(cache, cache_check_keys[num]);
+		counter += sched == NULL;
+		if (sched == NULL)
+		{
+			continue;
+		}
+
+		encodex_cbc_stream_init(cache_check_keys[num], &seed);
+		counter += sched->seed != seed;
+		counter += memcmp(&sched->schedule, &cache_check_scheds[num],
+				sizeof(sched->schedule)) != 0;
+
+		for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 3; idx++)
+		{
+			mem[idx] = 0xff & (idx * 3 + num);
+			exp[idx] = mem[idx];
+		}
+
+		encodex_schedule_cache_ctx_init(&ctx, sched);
+		encodex_schedule_cache_release(cache, sched);
+		encodex_ctx_encode_cbc(&ctx, mem, 3);
+		encodex_cbc(exp, 3, cache_check_keys[num]);
+
+		for (idx = 0; idx < 3; idx++)
+		{
+			counter += compare(
+				mem + idx * ENCODEX_BLOCK_SIZE_BYTES,
+				exp + idx * ENCODEX_BLOCK_SIZE_BYTES);
+		}
+	}
+
+	if (cache != NULL)
+	{
+		/* The hot key is found without rebuilding. */
+		sched = encodex_schedule_cache_acquire(cache, cache_check_keys[39]);
+		held[0] = encodex_schedule_cache_acquire(cache, cache_check_keys[39]);
+		counter += (sched == NULL) || (sched != held[0]);
+		encodex_schedule_cache_stats(cache, &hits, &misses);
+		counter += (hits != 2) || (misses != 40);
+		encodex_schedule_cache_release(cache, held[0]);
+		encodex_schedule_cache_release(cache, sched);
+
+		/* Held entries are never evicted, some shard runs out of them. */
+		misses = 0;
+		for (num = 0; num <= ENCODEX_CACHE_SHARDS; num++)
+		{
+			held[num] = encodex_schedule_cache_acquire(cache,
+					cache_check_keys[num + 50]);
+			misses += held[num] == NULL;
+		}
+
+		counter += (held[0] == NULL) || (misses == 0);
+
+		for (num = 0; num <= ENCODEX_CACHE_SHARDS; num++)
+		{
+			if (held[num] != NULL)
+			{
+				encodex_schedule_cache_release(cache, held[num]);
+			}
+		}
+
+		sched = encodex_schedule_cache_acquire(cache, cache_check_keys[50]);
+		counter += sched == NULL;
+		if (sched != NULL)
+		{
+			encodex_schedule_cache_release(cache, sched);
+		}
+
+		encodex_schedule_cache_destroy(cache);
+	}
+
+	/* Several threads share a cache smaller than the key set. */
+	cache = encodex_schedule_cache_create(ENCODEX_CACHE_SHARDS * 2);
+	counter += cache == NULL;
+
+	if (cache != NULL)
+	{
+		for (idx = 0; idx < 4; idx++)
+		{
+			if (pthread_create(&threads[idx], NULL,
+					cache_check_worker, cache) != 0)
+			{
+				threads[idx] = pthread_self();
+				counter++;
+			}
+		}
+
+		for (idx = 0; idx < 4; idx++)
+		{
+			void* res;
+
+			res = NULL;
+			if (!pthread_equal(threads[idx], pthread_self()))
+			{
+				(void)pthread_join(threads[idx], &res);
+			}
+
+			counter += res != NULL;
+		}
+
+		encodex_schedule_cache_destroy(cache);
+	}
+
+	printf("	%s\n", counter == 0 ? "OK" : "fail");
+}
+
+static void encodex_cbc_seek_check(void)
+{
+	size_t idx;
+	size_t block;
+	struct encodex_ctx ctx;
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+	uint8_t mem[ENCODEX_BLOCK_SIZE_BYTES * 300];
+	uint8_t exp[ENCODEX_BLOCK_SIZE_BYTES * 300];
+	size_t counter;
+
+	printf("\nENCODEX CBC seek check\n");
+
+	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+	{
+		key[idx] = 0xff & (0x01 + idx * 3);
+	}
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 300; idx++)
+	{
+		mem[idx] = idx % 251;
+		exp[idx] = mem[idx];
+	}
+
+	encodex_cbc(exp, 300, key);
+	encodex_ctx_init(&ctx, key);
+
+	counter = 0;
+	for (block = 300; block > 23; block -= 23)
+	{
+		encodex_cbc_seek(&ctx, block - 1);
+		encodex_ctx_encode_cbc(&ctx,
+				mem + (block - 1) * ENCODEX_BLOCK_SIZE_BYTES, 1);
+		counter += compare(
+			mem + (block - 1) * ENCODEX_BLOCK_SIZE_BYTES,
+			exp + (block - 1) * ENCODEX_BLOCK_SIZE_BYTES);
+
+		encodex_cbc_seek(&ctx, block - 1);
+		encodex_ctx_decode_cbc(&ctx,
+				mem + (block - 1) * ENCODEX_BLOCK_SIZE_BYTES, 1);
+	}
+
+	encodex_cbc_seek(&ctx, 0);
+	encodex_ctx_encode_cbc(&ctx, mem, 1);
+	counter += compare(mem, exp);
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 3; idx++)
+	{
+		mem[idx] = idx % 251;
+		exp[idx] = mem[idx];
+	}
+
+	encodex_cbc_seek(&ctx, 0x7654321u);
+	encodex_ctx_encode_cbc(&ctx, exp, 3);
+	encodex_cbc_seek(&ctx, 0x7654323u);
+	encodex_ctx_encode_cbc(&ctx, mem + ENCODEX_BLOCK_SIZE_BYTES * 2, 1);
+	counter += compare(
+		mem + ENCODEX_BLOCK_SIZE_BYTES * 2,
+		exp + ENCODEX_BLOCK_SIZE_BYTES * 2);
+
+	printf("	%s\n", counter == 0 ? "OK" : "fail");
+}
+
+static void encodex_cbc_parallel_check(void)
+{
+	size_t idx;
+	unsigned int threads;
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+	uint8_t mem[ENCODEX_BLOCK_SIZE_BYTES * 101];
+	uint8_t exp[ENCODEX_BLOCK_SIZE_BYTES * 101];
+	size_t counter;
+
+	printf("\nENCODEX parallel CBC check\n");
+
+	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+	{
+		key[idx] = 0xff & (0x01 + idx * 3);
+	}
+
+	counter = 0;
+	for (threads = 0; threads < 8; threads++)
+	{
+		for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 101; idx++)
+		{
+			mem[idx] = idx % 253;
+			exp[idx] = mem[idx];
+		}
+
+		encodex_cbc(exp, 101, key);
+		encodex_cbc_parallel(mem, 101, key, threads);
+
+		for (idx = 0; idx < 101; idx++)
+		{
+			counter += compare(
+				mem + idx * ENCODEX_BLOCK_SIZE_BYTES,
+				exp + idx * ENCODEX_BLOCK_SIZE_BYTES);
+		}
+
+		decodex_cbc_parallel(mem, 101, key, threads + 3);
+		decodex_cbc(exp, 101, key);
+
+		for (idx = 0; idx < 101; idx++)
+		{
+			counter += compare(
+				mem + idx * ENCODEX_BLOCK_SIZE_BYTES,
+				exp + idx * ENCODEX_BLOCK_SIZE_BYTES);
+		}
+	}
+
+	printf("	%s\n", counter == 0 ? "OK" : "fail");
+}
+
+static void encodex_cbc_update_check(void)
+{
+	size_t idx;
+	size_t len;
+	size_t pos;
+	size_t step;
+	size_t out_len;
+	size_t tail;
+	struct encodex_ctx ctx;
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+	uint8_t mem[ENCODEX_BLOCK_SIZE_BYTES * 12];
+	uint8_t exp[ENCODEX_BLOCK_SIZE_BYTES * 12];
+	uint8_t out[ENCODEX_BLOCK_SIZE_BYTES * 13];
+	uint8_t dec[ENCODEX_BLOCK_SIZE_BYTES * 13];
+	size_t counter;
+
+	printf("\nENCODEX CBC update/final check\n");
+
+	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+	{
+		key[idx] = 0xff & (0x01 + idx * 3);
+	}
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 12; idx++)
+	{
+		mem[idx] = idx % 251;
+	}
+
+	counter = 0;
+	for (len = 0; len <= ENCODEX_BLOCK_SIZE_BYTES * 11;
+			len += ENCODEX_BLOCK_SIZE_BYTES / 2 + 3)
+	{
+		/* Expected: the data padded by hand and encoded at once. */
+		tail = ENCODEX_BLOCK_SIZE_BYTES - len % ENCODEX_BLOCK_SIZE_BYTES;
+		for (idx = 0; idx < len + tail; idx++)
+		{
+			exp[idx] = idx < len ? mem[idx] : (uint8_t)(tail % 256);
+		}
+
+		encodex_cbc(exp, (len + tail) / ENCODEX_BLOCK_SIZE_BYTES, key);
+
+		for (step = 1; step < ENCODEX_BLOCK_SIZE_BYTES * 3; step += 7)
+		{
+			encodex_ctx_init(&ctx, key);
+			out_len = 0;
+			for (pos = 0; pos < len; pos += step)
+			{
+				out_len += encodex_cbc_update(&ctx, &mem[pos],
+						pos + step < len ? step : len - pos, &out[out_len]);
+			}
+
+			out_len += encodex_cbc_final(&ctx, &out[out_len]);
+			if ((out_len != len + tail) || (memcmp(out, exp, out_len) != 0))
+			{
+				printf("	encode length %lu step %lu differs\n",
+						(unsigned long)len, (unsigned long)step);
+				counter++;
+			}
+
+			encodex_ctx_init(&ctx, key);
+			out_len = 0;
+			for (pos = 0; pos < len + tail; pos += step)
+			{
+				out_len += decodex_cbc_update(&ctx, &exp[pos],
+						pos + step < len + tail ? step : len + tail - pos,
+						&dec[out_len]);
+			}
+
+			if ((decodex_cbc_final(&ctx, &dec[out_len], &tail) != 0)
+					|| (out_len + tail != len)
+					|| (memcmp(dec, mem, len) != 0))
+			{
+				printf("	decode length %lu step %lu differs\n",
+						(unsigned long)len, (unsigned long)step);
+				counter++;
+			}
+
+			tail = ENCODEX_BLOCK_SIZE_BYTES - len % ENCODEX_BLOCK_SIZE_BYTES;
+		}
+	}
+
+	/* In-place update with whole blocks. */
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 12; idx++)
+	{
+		exp[idx] = mem[idx];
+		out[idx] = mem[idx];
+	}
+
+	encodex_cbc(exp, 12, key);
+	encodex_ctx_init(&ctx, key);
+	(void)encodex_cbc_update(&ctx, out, ENCODEX_BLOCK_SIZE_BYTES * 5, out);
+	(void)encodex_cbc_update(&ctx, &out[ENCODEX_BLOCK_SIZE_BYTES * 5],
+			ENCODEX_BLOCK_SIZE_BYTES * 7, &out[ENCODEX_BLOCK_SIZE_BYTES * 5]);
+	counter += memcmp(out, exp, ENCODEX_BLOCK_SIZE_BYTES * 12) != 0;
+
+	/* Wrong padding and truncated data are rejected. */
+	encodex_ctx_init(&ctx, key);
+	(void)decodex_cbc_update(&ctx, exp, ENCODEX_BLOCK_SIZE_BYTES * 3, dec);
+	counter += decodex_cbc_final(&ctx, dec, &out_len) == 0;
+
+	encodex_ctx_init(&ctx, key);
+	(void)decodex_cbc_update(&ctx, exp, ENCODEX_BLOCK_SIZE_BYTES - 1, dec);
+	counter += decodex_cbc_final(&ctx, dec, &out_len) == 0;
+
+	printf("	%s\n", counter == 0 ? "OK" : "fail");
+}
+
+static void encodex_cbc_iov_check(void)
+{
+	size_t idx;
+	size_t num;
+	size_t pos;
+	struct encodex_ctx ctx;
+	struct encodex_iovec iov[ENCODEX_BLOCK_SIZE_BYTES];
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+	uint8_t mem[ENCODEX_BLOCK_SIZE_BYTES * 20];
+	uint8_t exp[ENCODEX_BLOCK_SIZE_BYTES * 20];
+	size_t counter;
+
+	/* Segment sizes: tiny, unaligned and multi-block ones. */
+	static const size_t sizes[] = { 1, 5, 31, 32, 33, 64, 3, 97, 2, 40 };
+
+	printf("\nENCODEX CBC scatter-gather check\n");
+
+	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+	{
+		key[idx] = 0xff & (0x01 + idx * 3);
+	}
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 20; idx++)
+	{
+		mem[idx] = idx % 251;
+		exp[idx] = mem[idx];
+	}
+
+	encodex_cbc(exp, 20, key);
+
+	/* The first segment is whole blocks, so it may be a call on its own. */
+	iov[0].iov_base = mem;
+	iov[0].iov_len = ENCODEX_BLOCK_SIZE_BYTES * 3;
+
+	num = 1;
+	for (pos = iov[0].iov_len; pos < ENCODEX_BLOCK_SIZE_BYTES * 20; num++)
+	{
+		iov[num].iov_base = &mem[pos];
+		iov[num].iov_len = sizes[num % (sizeof(sizes) / sizeof(sizes[0]))];
+		if (pos + iov[num].iov_len > ENCODEX_BLOCK_SIZE_BYTES * 20)
+		{
+			iov[num].iov_len = ENCODEX_BLOCK_SIZE_BYTES * 20 - pos;
+		}
+
+		pos += iov[num].iov_len;
+	}
+
+	counter = 0;
+
+	/* A partial block is rejected before anything is touched. */
+	encodex_ctx_init(&ctx, key);
+	counter += encodex_cbc_iov(&ctx, &iov[1], 2) != -1;
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 20; idx++)
+	{
+		counter += mem[idx] != idx % 251;
+	}
+
+	/* The chain continues through the calls. */
+	counter += encodex_cbc_iov(&ctx, iov, 1) != 0;
+	counter += encodex_cbc_iov(&ctx, &iov[1], num - 1) != 0;
+
+	for (idx = 0; idx < 20; idx++)
+	{
+		counter += compare(
+			mem + idx * ENCODEX_BLOCK_SIZE_BYTES,
+			exp + idx * ENCODEX_BLOCK_SIZE_BYTES);
+	}
+
+	encodex_ctx_init(&ctx, key);
+	counter += decodex_cbc_iov(&ctx, iov, num) != 0;
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 20; idx++)
+	{
+		counter += mem[idx] != idx % 251;
+	}
+
+	printf("	%s\n", counter == 0 ? "OK" : "fail");
+}
+
+static void encodex_to_check(void)
+{
+	size_t idx;
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+	uint8_t src[ENCODEX_BLOCK_SIZE_BYTES * 7];
+	uint8_t dst[ENCODEX_BLOCK_SIZE_BYTES * 7];
+	uint8_t exp[ENCODEX_BLOCK_SIZE_BYTES * 7];
+	size_t counter;
+
+	printf("\nENCODEX out-of-place check\n");
+
+	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+	{
+		key[idx] = 0xff & (0x01 + idx * 3);
+	}
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 7; idx++)
+	{
+		src[idx] = idx % 251;
+		exp[idx] = src[idx];
+	}
+
+	counter = 0;
+
+	encodex_ecb(exp, 7, key);
+	encodex_ecb_to(dst, src, 7, key);
+	counter += memcmp(dst, exp, sizeof(dst)) != 0;
+	decodex_ecb_to(exp, dst, 7, key);
+	counter += memcmp(exp, src, sizeof(src)) != 0;
+
+	encodex_cbc(exp, 7, key);
+	encodex_cbc_to(dst, src, 7, key);
+	counter += memcmp(dst, exp, sizeof(dst)) != 0;
+	decodex_cbc_to(exp, dst, 7, key);
+	counter += memcmp(exp, src, sizeof(src)) != 0;
+
+	/* The source is left intact. */
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 7; idx++)
+	{
+		counter += src[idx] != idx % 251;
+	}
+
+	/* The same pointer works as the in-place call. */
+	encodex_cbc_to(exp, exp, 7, key);
+	counter += memcmp(dst, exp, sizeof(dst)) != 0;
+	decodex_ecb_to(dst, dst, 7, key);
+	decodex_ecb(exp, 7, key);
+	counter += memcmp(dst, exp, sizeof(dst)) != 0;
+
+	printf("	%s\n", counter == 0 ? "OK" : "fail");
+}
+
+#ifdef ENCODEX_PROFILE
+
+static void* profile_check_worker(void* arg)
+{
+	struct encodex_profile prof;
+	uint8_t mem[ENCODEX_BLOCK_SIZE_BYTES];
+
+	memset(mem, 0, sizeof(mem));
+	encodex_profile_reset();
+	encodex(mem, (const uint8_t*)arg);
+	encodex_profile_snapshot(&prof);
+
+	return (prof.stage[ENCODEX_PROFILE_ROL].calls == 1) ? NULL : arg;
+}
+
+static void encodex_profile_check(void)
+{
+	size_t idx;
+	struct encodex_profile prof;
+	uint8_t key[ENCODEX_KEY_SIZE_BYTES];
+	uint8_t mem[ENCODEX_BLOCK_SIZE_BYTES * 3];
+
+	printf("\nENCODEX profile counters\n");
+
+	for (idx = 0; idx < ENCODEX_KEY_SIZE_BYTES; idx++)
+	{
+		key[idx] = 0xff & (0x01 + idx * 3);
+	}
+
+	for (idx = 0; idx < ENCODEX_BLOCK_SIZE_BYTES * 3; idx++)
+	{
+		mem[idx] = idx % 251;
+	}
+
+	encodex_profile_reset();
+	encodex(mem, key);
+	encodex(mem, key);
+	decodex(mem, key);
+	encodex_cbc(mem, 3, key);
+	encodex_profile_snapshot(&prof);
+
+	for (idx = 0; idx < ENCODEX_PROFILE_STAGES; idx++)
+	{
+		printf("	%-16s calls %lu bytes %lu cycles %lu\n",
+				encodex_profile_name((enum encodex_profile_stage)idx),
+				(unsigned long)prof.stage[idx].calls,
+				(unsigned long)prof.stage[idx].bytes,
+				(unsigned long)prof.stage[idx].cycles);
+	}
+
+	if ((prof.stage[ENCODEX_PROFILE_ROL].calls != 2)
+			|| (prof.stage[ENCODEX_PROFILE_SHUFFLE].bytes
+				!= 2 * ENCODEX_BLOCK_SIZE_BYTES)
+			|| (prof.stage[ENCODEX_PROFILE_REVERT_NOIZE].calls != 1)
+			|| (prof.stage[ENCODEX_PROFILE_CBC].calls != 3)
+			|| (prof.stage[ENCODEX_PROFILE_SCHEDULE].calls != 4))
+	{
+		printf("	fail\n");
+		return;
+	}
+
+	encodex_profile_reset();
+	encodex_profile_snapshot(&prof);
+	if (prof.stage[ENCODEX_PROFILE_ROL].calls != 0)
+	{
+		printf("	fail\n");
+		return;
+	}
+
+	/* Other threads count on their own. */
+	{
+		pthread_t thread;
+		void* res;
+
+		res = key;
+		if (pthread_create(&thread, NULL, profile_check_worker, key) == 0)
+		{
+			(void)pthread_join(thread, &res);
+		}
+
+		encodex_profile_snapshot(&prof);
+		if ((res != NULL) || (prof.stage[ENCODEX_PROFILE_ROL].calls != 0))
+		{
+			printf("	fail\n");
+			return;
+		}
+	}
+
+	printf("	OK\n");
+}
+
+#endif /* ENCODEX_PROFILE */
+
 int main(int argc, char** argv)
 {
 	printf("== Encodex tests ==\n");
@@ -258,7 +1296,22 @@ int main(int argc, char** argv)
 	noize_denoize_check();
 	shuffle_check();
 	encodex_check();
+	encodex_ecb_check();
+	encodex_simd_check();
+	encodex_simd_batch_check();
+	encodex_sbox_check();
 	encodex_cbc_check();
+	encodex_ctx_check();
+	encodex_schedule_check();
+	encodex_schedule_cache_check();
+	encodex_cbc_seek_check();
+	encodex_cbc_parallel_check();
+	encodex_cbc_update_check();
+	encodex_cbc_iov_check();
+	encodex_to_check();
+#ifdef ENCODEX_PROFILE
+	encodex_profile_check();
+#endif /* ENCODEX_PROFILE */
 
 	return 0;
 }